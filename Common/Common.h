@@ -10,9 +10,10 @@ constexpr uint8_t MAX_USER_PW = 64;
 constexpr uint8_t MAX_USER_NAME = 32;
 constexpr uint8_t MAX_ROOM_NAME = 32;
 constexpr uint16_t MAX_ROOM_USER = 32;
+constexpr uint16_t MAX_ROOM_USER_CHUNK = 64;	// 멤버 목록 패킷 하나에 담는 최대 인원
 constexpr uint8_t MAX_ROOM_PAGE_COUNT = 10;
-constexpr uint16_t MAX_ROOM_COUNT = 100;
-constexpr uint16_t INVALID_ROOM_ID = UINT16_MAX;
+constexpr uint32_t MAX_ROOM_COUNT = 500000;	// 방 풀 상한 (청크 단위로 필요할 때 확장)
+constexpr uint32_t INVALID_ROOM_ID = UINT32_MAX;
 
 enum class PacketType : uint16_t
 {
@@ -34,6 +35,8 @@ enum class PacketType : uint16_t
 	WHISPER_RESPONSE = 3008,
 	WHISPER_NOTIFY = 3009,
 
+	ROOM_HISTORY_NOTIFY = 3010,
+
 	ROOM_LIST_REQUEST = 4001,
 	ROOM_LIST_RESPONSE = 4002,
 
@@ -46,6 +49,14 @@ enum class PacketType : uint16_t
 	LEAVE_ROOM_REQUEST = 4007,
 	LEAVE_ROOM_RESPONSE = 4008,
 
+	ROOM_USER_LIST_REQUEST = 4009,
+	ROOM_USER_LIST_RESPONSE = 4010,
+
+	ROOM_SEARCH_REQUEST = 4011,
+	ROOM_SEARCH_RESPONSE = 4012,
+
+	QUICK_JOIN_REQUEST = 4013,		// 응답은 JOIN_ROOM_RESPONSE
+
 	USER_JOIN_NOTIFY = 5001,
 	USER_LEAVE_NOTIFY = 5002,
 
@@ -84,8 +95,10 @@ enum class ErrorCode : uint16_t
 	PERMISSION_DENIED = 2004,
 	INVALID_ROOM_REQUEST = 2005,
 	ROOM_CREATION_FAIL = 2006,
+	NO_AVAILABLE_ROOM = 2007,
 
 	// Server
+	SERVER_BUSY = 9001,		// 인증 대기열이 가득 찼다. 로그인 응답이면 retryAfterMs 뒤 다시 시도
 	SERVER_ERROR = 9999
 };
 
@@ -93,7 +106,7 @@ enum class ErrorCode : uint16_t
 
 struct RoomInfo
 {
-	uint16_t roomId;
+	uint32_t roomId;
 	char roomName[MAX_ROOM_NAME + 1];
 	uint16_t maxUserCount;
 	uint16_t curUserCount;
@@ -103,7 +116,7 @@ struct RoomInfo
 		memset(roomName, 0, sizeof(roomName));
 	}
 
-	RoomInfo(uint16_t id, std::string_view name, uint16_t max, uint16_t cur)
+	RoomInfo(uint32_t id, std::string_view name, uint16_t max, uint16_t cur)
 		: roomId(id), maxUserCount(max), curUserCount(cur)
 	{
 		memset(roomName, 0, sizeof(roomName)); 
@@ -113,7 +126,7 @@ struct RoomInfo
 
 struct UserInfo
 {
-	uint16_t userId;
+	uint32_t userId;
 	char nickname[MAX_USER_NAME + 1];
 
 	UserInfo() : userId(0)
@@ -121,7 +134,7 @@ struct UserInfo
 		memset(nickname, 0, sizeof(nickname));
 	}
 
-	UserInfo(uint16_t id, std::string_view name)
+	UserInfo(uint32_t id, std::string_view name)
 		: userId(id)
 	{
 		memset(nickname, 0, sizeof(nickname));
@@ -87,7 +87,8 @@ struct LoginResPacket : PacketBase<LoginResPacket>
 {
 	ErrorCode result;
 	char nickname[MAX_USER_NAME + 1];
-	LoginResPacket() : PacketBase(PacketType::LOGIN_RESPONSE)
+	uint16_t retryAfterMs;		// SERVER_BUSY일 때 이만큼 기다렸다 다시 보낸다
+	LoginResPacket() : PacketBase(PacketType::LOGIN_RESPONSE), retryAfterMs(0)
 	{
 		memset(nickname, 0, sizeof(nickname));
 	}
@@ -200,37 +201,34 @@ struct WhisperChatNotiPacket : PacketBase<WhisperChatNotiPacket>
 	const char* GetSender() { return sender; }
 };
 
+// 방 멤버 변경분. 클라이언트는 입장 시 받은 목록에 이 델타만 반영한다.
 struct UserJoinNotifyPacket : PacketBase<UserJoinNotifyPacket>
 {
-	char user[MAX_USER_NAME + 1];
-	UserJoinNotifyPacket() : PacketBase(PacketType::USER_JOIN_NOTIFY)
+	uint32_t roomId;
+	UserInfo user;
+
+	UserJoinNotifyPacket() : PacketBase(PacketType::USER_JOIN_NOTIFY), roomId(0)
 	{
-		memset(user, 0, sizeof(user));
 	}
 
-	void SetUser(std::string_view name)
+	void SetUser(uint32_t id, std::string_view name)
 	{
-		if (name.empty())
-			return;
-
-		strncpy_s(user, MAX_USER_NAME + 1, name.data(), _TRUNCATE);
+		user = UserInfo(id, name);
 	}
 };
 
 struct UserLeaveNotifyPacket : PacketBase<UserLeaveNotifyPacket>
 {
-	char user[MAX_USER_NAME + 1];
-	UserLeaveNotifyPacket() : PacketBase(PacketType::USER_LEAVE_NOTIFY)
+	uint32_t roomId;
+	UserInfo user;
+
+	UserLeaveNotifyPacket() : PacketBase(PacketType::USER_LEAVE_NOTIFY), roomId(0)
 	{
-		memset(user, 0, sizeof(user));
 	}
 
-	void SetUser(std::string_view name)
-	{		
-		if (name.empty())
-			return;
-
-		strncpy_s(user, sizeof(user), name.data(), _TRUNCATE);
+	void SetUser(uint32_t id, std::string_view name)
+	{
+		user = UserInfo(id, name);
 	}
 };
 
@@ -263,7 +261,7 @@ struct CreateRoomResPacket : PacketBase<CreateRoomResPacket>
 	{
 	}
 
-	void SetRoomInfo(uint16_t roomId, std::string_view roomName, uint16_t maxUserCount, uint16_t curUserCount)
+	void SetRoomInfo(uint32_t roomId, std::string_view roomName, uint16_t maxUserCount, uint16_t curUserCount)
 	{
 		if (roomName.empty()) 
 			return;
@@ -278,23 +276,28 @@ struct CreateRoomResPacket : PacketBase<CreateRoomResPacket>
 
 struct JoinRoomReqPacket : PacketBase<JoinRoomReqPacket>
 {
-	uint16_t roomId;
+	uint32_t roomId;
 
 	JoinRoomReqPacket() : PacketBase(PacketType::JOIN_ROOM_REQUEST), roomId(0) {}
 
-	void JoinRoom(uint16_t id)
+	void JoinRoom(uint32_t id)
 	{
 		roomId = id;
 	}
 };
 
+// 가변 길이. 헤더 뒤에 userCount개의 UserInfo가 이어진다.
+// 방 인원(room.curUserCount)이 MAX_ROOM_USER_CHUNK를 넘으면 나머지는 RoomUserListResPacket으로 이어서 온다.
 struct JoinRoomResPacket : PacketBase<JoinRoomResPacket>
 {
 	ErrorCode result;
 	RoomInfo room;
-	UserInfo users[MAX_ROOM_USER];
+	uint16_t totalCount;	// 명단 전체 인원. userCount보다 많으면 나머지는 RoomUserListResPacket으로 이어 온다
+	uint16_t userCount;		// 이 패킷 뒤에 붙은 UserInfo 수
 
-	JoinRoomResPacket() : PacketBase(PacketType::JOIN_ROOM_RESPONSE) {}
+	JoinRoomResPacket() : PacketBase(PacketType::JOIN_ROOM_RESPONSE), result(ErrorCode::SUCCESS), totalCount(0), userCount(0) {}
+
+	const UserInfo* GetUsers() const { return reinterpret_cast<const UserInfo*>(this + 1); }
 };
 
 struct LeaveRoomReqPacket : PacketBase<LeaveRoomReqPacket>
@@ -309,17 +312,42 @@ struct LeaveRoomResPacket : PacketBase<LeaveRoomResPacket>
 	LeaveRoomResPacket() : PacketBase(PacketType::LEAVE_ROOM_RESPONSE) {}
 };
 
+struct RoomUserListReqPacket : PacketBase<RoomUserListReqPacket>
+{
+	RoomUserListReqPacket() : PacketBase(PacketType::ROOM_USER_LIST_REQUEST) {}
+};
+
+// 가변 길이. 헤더 뒤에 userCount개의 UserInfo가 이어진다.
+// 전체 totalCount명을 MAX_ROOM_USER_CHUNK명씩 나눠 여러 패킷으로 보낸다.
+struct RoomUserListResPacket : PacketBase<RoomUserListResPacket>
+{
+	ErrorCode result;
+	uint16_t totalCount;
+	uint16_t firstIndex;	// 이 묶음 첫 사용자의 명단 내 위치. firstIndex + userCount == totalCount면 마지막 묶음
+	uint16_t userCount;
+
+	RoomUserListResPacket() : PacketBase(PacketType::ROOM_USER_LIST_RESPONSE),
+		result(ErrorCode::SUCCESS),
+		totalCount(0),
+		firstIndex(0),
+		userCount(0)
+	{
+	}
+
+	const UserInfo* GetUsers() const { return reinterpret_cast<const UserInfo*>(this + 1); }
+};
+
 struct RoomListReqPacket : PacketBase<RoomListReqPacket>
 {
-	uint16_t page;
+	uint32_t cursor;	// 이 id 이상인 방부터 한 페이지. 처음엔 0, 다음부터는 응답의 nextCursor
 
-	RoomListReqPacket() : PacketBase(PacketType::ROOM_LIST_REQUEST), page(0)
+	RoomListReqPacket() : PacketBase(PacketType::ROOM_LIST_REQUEST), cursor(0)
 	{
 	}
 
-	void SetPage(uint16_t pageNumber)
+	void SetCursor(uint32_t roomId)
 	{
-		page = pageNumber;
+		cursor = roomId;
 	}
 };
 
@@ -327,15 +355,55 @@ struct RoomListResPacket : PacketBase<RoomListResPacket>
 {
 	ErrorCode result;
 	uint16_t roomCount;
+	uint32_t nextCursor;	// 마지막 방 id + 1. 더 없으면 INVALID_ROOM_ID
 	RoomInfo rooms[MAX_ROOM_PAGE_COUNT];
 
 	RoomListResPacket() : PacketBase(PacketType::ROOM_LIST_RESPONSE),
 		result(ErrorCode::SUCCESS),
+		roomCount(0),
+		nextCursor(INVALID_ROOM_ID)
+	{
+	}
+};
+
+struct RoomSearchReqPacket : PacketBase<RoomSearchReqPacket>
+{
+	char prefix[MAX_ROOM_NAME + 1];
+	uint16_t page;
+
+	RoomSearchReqPacket() : PacketBase(PacketType::ROOM_SEARCH_REQUEST), page(0)
+	{
+		memset(prefix, 0, sizeof(prefix));
+	}
+
+	void SetQuery(std::string_view namePrefix, uint16_t pageNumber)
+	{
+		strncpy_s(prefix, sizeof(prefix), namePrefix.data(), _TRUNCATE);
+		page = pageNumber;
+	}
+};
+
+struct RoomSearchResPacket : PacketBase<RoomSearchResPacket>
+{
+	ErrorCode result;
+	uint32_t totalCount;	// 접두사와 일치하는 전체 방 수
+	uint16_t roomCount;
+	RoomInfo rooms[MAX_ROOM_PAGE_COUNT];
+
+	RoomSearchResPacket() : PacketBase(PacketType::ROOM_SEARCH_RESPONSE),
+		result(ErrorCode::SUCCESS),
+		totalCount(0),
 		roomCount(0)
 	{
 	}
 };
 
+// 빈자리가 있는 방 중 가장 많이 찬 방에 바로 입장한다. 응답은 JoinRoomResPacket
+struct QuickJoinReqPacket : PacketBase<QuickJoinReqPacket>
+{
+	QuickJoinReqPacket() : PacketBase(PacketType::QUICK_JOIN_REQUEST) {}
+};
+
 struct RoomChatReqPacket : PacketBase<RoomChatReqPacket>
 {
 	char message[MAX_CHAT_SIZE + 1];
@@ -382,6 +450,17 @@ struct RoomChatNotiPacket : PacketBase<RoomChatNotiPacket>
 	}
 };
 
+// 입장 직후 한 번 보내는 방의 최근 채팅. 가변 길이 패킷으로 헤더 뒤에 messageCount개의 레코드가 이어진다.
+//   [uint8 nameLen][name][uint16 messageLen][message]
+struct RoomHistoryNotiPacket : PacketBase<RoomHistoryNotiPacket>
+{
+	uint16_t messageCount;
+
+	RoomHistoryNotiPacket() : PacketBase(PacketType::ROOM_HISTORY_NOTIFY), messageCount(0)
+	{
+	}
+};
+
 struct SystemNotiPacket : PacketBase<SystemNotiPacket>
 {
 	char message[MAX_CHAT_SIZE + 1];
@@ -13,7 +13,11 @@ void PrintMenu()
 	cout << "3. Mixed Test" << endl;
 	cout << "4. Performance Test" << endl;
 	cout << "5. Room Test" << endl;
-	cout << "6. Exit" << endl;
+	cout << "6. Multi Room Test" << endl;
+	cout << "7. Large Room Fanout Test" << endl;
+	cout << "8. Login Storm Test" << endl;
+	cout << "9. Register Burst Test" << endl;
+	cout << "10. Exit" << endl;
 	cout << "========================================" << endl;
 	cout << "Select: ";
 }
@@ -70,6 +74,53 @@ int main(int argc, char* argv[])
 			testManager.RoomTest();
 			break;
 		case 6:
+		{
+			// 서버 워커 수는 CSV 기록용. 서버를 워커 수별로 재시작하며 측정한다.
+			int roomCount, msgCount, serverWorkers;
+			cout << "Room count: ";
+			cin >> roomCount;
+			cout << "Messages per client: ";
+			cin >> msgCount;
+			cout << "Server worker threads: ";
+			cin >> serverWorkers;
+			testManager.RunMultiRoomTest(roomCount, msgCount, serverWorkers);
+			break;
+		}
+		case 7:
+		{
+			// 1k / 10k / 50k 명으로 각각 실행한다. 그만큼의 클라이언트를 먼저 접속시켜야 한다.
+			int memberCount, msgCount, serverWorkers;
+			cout << "Room members: ";
+			cin >> memberCount;
+			cout << "Messages: ";
+			cin >> msgCount;
+			cout << "Server worker threads: ";
+			cin >> serverWorkers;
+			testManager.RunLargeRoomFanoutTest(memberCount, msgCount, serverWorkers);
+			break;
+		}
+		case 8:
+		{
+			int stormCount, serverWorkers;
+			cout << "Storm clients (e.g. 1000): ";
+			cin >> stormCount;
+			cout << "Server worker threads: ";
+			cin >> serverWorkers;
+			testManager.RunLoginStormTest(stormCount, serverWorkers);
+			break;
+		}
+		case 9:
+		{
+			// 서버를 기본 모드와 --no-register-batch 모드로 각각 띄워 비교한다
+			int registerCount, serverBatching;
+			cout << "Registrations (e.g. 2000): ";
+			cin >> registerCount;
+			cout << "Server register batching (1=on, 0=off): ";
+			cin >> serverBatching;
+			testManager.RunRegisterBurstTest(registerCount, serverBatching != 0);
+			break;
+		}
+		case 10:
 			cout << "Exiting..." << endl;
 			WSACleanup();
 			return 0;
@@ -1,6 +1,7 @@
 #include "TestClient.h"
 #include <iostream>
 #include <WS2tcpip.h>
+#include <chrono>
 
 TestClient::TestClient(int id, const string& name, const char* serverIP, int serverPort)
 	: mId(id)
@@ -118,7 +119,7 @@ bool TestClient::Register(int num)
 		mRegisterResult == ErrorCode::ID_ALREADY_EXISTS);
 }
 
-bool TestClient::Login(int num)
+bool TestClient::Login(int num, int timeoutMs)
 {
 	mIsAuthenticated = false;
 
@@ -127,18 +128,35 @@ bool TestClient::Login(int num)
 	LoginReqPacket packet;
 	packet.SetLoginInfo(id.c_str(), "testpw");
 
-	if (!SendAll(mSocket, (const char*)&packet, packet.size))
-	{
-		cout << "[Client " << num << "] Login send error" << endl;
-		return false;
-	}
+	auto deadline = chrono::steady_clock::now() + chrono::milliseconds(timeoutMs);
 
-	for (int i = 0; i < 300 && !mIsAuthenticated && mIsRunning; i++)
+	while (true)
 	{
-		Sleep(10);
-	}
+		mLoginResponseArrived = false;
 
-	return mIsAuthenticated;
+		if (!SendAll(mSocket, (const char*)&packet, packet.size))
+		{
+			cout << "[Client " << num << "] Login send error" << endl;
+			return false;
+		}
+
+		while (!mLoginResponseArrived && mIsRunning && chrono::steady_clock::now() < deadline)
+		{
+			Sleep(10);
+		}
+
+		if (!mLoginResponseArrived || mLoginResult != ErrorCode::SERVER_BUSY)
+			return mIsAuthenticated;
+
+		// 서버가 알려 준 시간에 지터를 더해 쉬었다 보낸다. 모두 같은 순간에 다시 몰리지 않게 한다
+		int retryAfterMs = mLoginRetryAfterMs;
+		int backoffMs = retryAfterMs + rand() % (retryAfterMs / 2 + 1);
+		if (chrono::steady_clock::now() + chrono::milliseconds(backoffMs) >= deadline)
+			return false;
+
+		mLoginRetryCount++;
+		Sleep(backoffMs);
+	}
 }
 
 bool TestClient::SendLobbyChat(const string& message)
@@ -192,7 +210,7 @@ bool TestClient::CreateRoom(const string& name, uint16_t maxUser)
 	return mCreateRoomResult == ErrorCode::SUCCESS;
 }
 
-bool TestClient::RequestRoomList(uint16_t page)
+bool TestClient::RequestRoomList(uint32_t cursor)
 {
 	if (!mIsAuthenticated)
 		return false;
@@ -200,9 +218,10 @@ bool TestClient::RequestRoomList(uint16_t page)
 	mRoomListArrived = false;
 	mRoomListResult  = ErrorCode::SERVER_ERROR;
 	mRoomListCount   = 0;
+	mRoomListNextCursor = INVALID_ROOM_ID;
 
 	RoomListReqPacket packet;
-	packet.SetPage(page);
+	packet.SetCursor(cursor);
 
 	if (!SendAll(mSocket, (const char*)&packet, packet.size))
 		return false;
@@ -219,7 +238,7 @@ bool TestClient::RequestRoomList(uint16_t page)
 	return mRoomListResult == ErrorCode::SUCCESS;
 }
 
-bool TestClient::JoinRoom(uint16_t roomId)
+bool TestClient::JoinRoom(uint32_t roomId)
 {
 	if (!mIsAuthenticated)
 		return false;
@@ -245,6 +264,31 @@ bool TestClient::JoinRoom(uint16_t roomId)
 	return mJoinRoomResult == ErrorCode::SUCCESS;
 }
 
+bool TestClient::QuickJoin()
+{
+	if (!mIsAuthenticated)
+		return false;
+
+	mJoinRoomArrived = false;
+	mJoinRoomResult = ErrorCode::SERVER_ERROR;
+
+	QuickJoinReqPacket packet;
+
+	if (!SendAll(mSocket, (const char*)&packet, packet.size))
+		return false;
+
+	for (int i = 0; i < 300 && !mJoinRoomArrived && mIsRunning; i++)
+		Sleep(10);
+
+	if (!mJoinRoomArrived)
+	{
+		cout << "[" << mName << "] QuickJoin response timeout" << endl;
+		return false;
+	}
+
+	return mJoinRoomResult == ErrorCode::SUCCESS;
+}
+
 bool TestClient::LeaveRoom()
 {
 	if (!mIsAuthenticated)
@@ -281,6 +325,58 @@ bool TestClient::SendRoomChat(const string& message)
 	return SendAll(mSocket, (const char*)&packet, packet.size);
 }
 
+bool TestClient::RequestRoomUserList()
+{
+	if (!mIsAuthenticated || mCurrentRoomId == INVALID_ROOM_ID)
+		return false;
+
+	mRoomUserListArrived = false;
+	mRoomUserListResult = ErrorCode::SERVER_ERROR;
+
+	RoomUserListReqPacket packet;
+
+	if (!SendAll(mSocket, (const char*)&packet, packet.size))
+		return false;
+
+	for (int i = 0; i < 300 && !mRoomUserListArrived && mIsRunning; i++)
+		Sleep(10);
+
+	if (!mRoomUserListArrived)
+	{
+		cout << "[" << mName << "] RoomUserList response timeout" << endl;
+		return false;
+	}
+
+	return mRoomUserListResult == ErrorCode::SUCCESS;
+}
+
+bool TestClient::SearchRoom(const string& prefix, uint16_t page)
+{
+	if (!mIsAuthenticated)
+		return false;
+
+	mSearchArrived = false;
+	mSearchResult = ErrorCode::SERVER_ERROR;
+	mSearchTotalCount = 0;
+
+	RoomSearchReqPacket packet;
+	packet.SetQuery(prefix, page);
+
+	if (!SendAll(mSocket, (const char*)&packet, packet.size))
+		return false;
+
+	for (int i = 0; i < 300 && !mSearchArrived && mIsRunning; i++)
+		Sleep(10);
+
+	if (!mSearchArrived)
+	{
+		cout << "[" << mName << "] RoomSearch response timeout" << endl;
+		return false;
+	}
+
+	return mSearchResult == ErrorCode::SUCCESS;
+}
+
 unsigned WINAPI TestClient::RecvThreadFunc(void* arg)
 {
 	TestClient* client = (TestClient*)arg;
@@ -307,6 +403,13 @@ void TestClient::RecvLoop()
 		}
 
 		PacketHeader* header = (PacketHeader*)mRecvBuffer;
+		if (header->size > MAX_SOCKBUF)
+		{
+			cout << "[" << mName << "] Packet too large: " << header->size << endl;
+			mIsRunning = false;
+			return;
+		}
+
 		int remainingSize = header->size - sizeof(PacketHeader);
 
 		if (remainingSize > 0)
@@ -364,6 +467,21 @@ void TestClient::ProcessPacket(PacketHeader* packet)
 	case PacketType::ROOM_CHAT_NOTIFY:
 		HandleRoomChatNoti((RoomChatNotiPacket*)packet);
 		break;
+	case PacketType::ROOM_USER_LIST_RESPONSE:
+		HandleRoomUserListResponse((RoomUserListResPacket*)packet);
+		break;
+	case PacketType::ROOM_SEARCH_RESPONSE:
+		HandleRoomSearchResponse((RoomSearchResPacket*)packet);
+		break;
+	case PacketType::ROOM_HISTORY_NOTIFY:
+		HandleRoomHistoryNoti((RoomHistoryNotiPacket*)packet);
+		break;
+	case PacketType::USER_JOIN_NOTIFY:
+		HandleUserJoinNoti((UserJoinNotifyPacket*)packet);
+		break;
+	case PacketType::USER_LEAVE_NOTIFY:
+		HandleUserLeaveNoti((UserLeaveNotifyPacket*)packet);
+		break;
 	default:
 		break;
 	}
@@ -382,10 +500,17 @@ void TestClient::HandleLoginResponse(LoginResPacket* packet)
 		mIsAuthenticated = true;
 		mName = packet->nickname;
 	}
+	else if (packet->result == ErrorCode::SERVER_BUSY)
+	{
+		mLoginRetryAfterMs = packet->retryAfterMs;
+	}
 	else
 	{
 		mIsRunning = false;
 	}
+
+	mLoginResult = packet->result;
+	mLoginResponseArrived = true;
 }
 
 void TestClient::HandleLobbyChatResponse(LobbyChatResPacket* packet)
@@ -414,6 +539,7 @@ void TestClient::HandleCreateRoomResponse(CreateRoomResPacket* packet)
 	{
 		mCreatedRoomInfo = packet->room;
 		mCurrentRoomId = packet->room.roomId;
+		mRoomMemberCount = 1;
 	}
 	mCreateRoomArrived = true;
 }
@@ -424,6 +550,7 @@ void TestClient::HandleRoomListResponse(RoomListResPacket* packet)
 	if (packet->result == ErrorCode::SUCCESS)
 	{
 		mRoomListCount = packet->roomCount;
+		mRoomListNextCursor = packet->nextCursor;
 		memcpy_s(mRoomList, sizeof(mRoomList), packet->rooms, sizeof(RoomInfo) * packet->roomCount);
 	}
 	mRoomListArrived = true;
@@ -435,6 +562,12 @@ void TestClient::HandleJoinRoomResponse(JoinRoomResPacket* packet)
 	if (packet->result == ErrorCode::SUCCESS)
 	{
 		mCurrentRoomId = packet->room.roomId;
+		mReceivedHistoryCount = 0;
+
+		// 나머지 멤버는 ROOM_USER_LIST_RESPONSE로 이어서 온다
+		mRoomMemberCount = packet->userCount;
+		mRoomUserListReceived = packet->userCount;
+		mRoomUserListTotal = packet->totalCount;
 	}
 	mJoinRoomArrived = true;
 }
@@ -445,6 +578,7 @@ void TestClient::HandleLeaveRoomResponse(LeaveRoomResPacket* packet)
 	if (packet->result == ErrorCode::SUCCESS)
 	{
 		mCurrentRoomId = INVALID_ROOM_ID;
+		mRoomMemberCount = 0;
 	}
 	mLeaveRoomArrived = true;
 }
@@ -456,5 +590,116 @@ void TestClient::HandleRoomChatResponse(RoomChatResPacket* packet)
 
 void TestClient::HandleRoomChatNoti(RoomChatNotiPacket* packet)
 {
+	// 팬아웃 측정용 메시지는 보낸 시각을 담고 있다 (같은 프로세스라 steady_clock을 그대로 비교)
+	if (strncmp(packet->message, "FANOUT ", 7) == 0)
+	{
+		long long sentNs = atoll(packet->message + 7);
+		long long nowNs = chrono::duration_cast<chrono::nanoseconds>(
+			chrono::steady_clock::now().time_since_epoch()).count();
+
+		lock_guard<mutex> lock(mFanoutLock);
+		mFanoutLatencyUs.push_back((nowNs - sentNs) / 1000);
+	}
+
 	mReceivedRoomChatCount++;
 }
+
+vector<long long> TestClient::TakeFanoutLatencies()
+{
+	vector<long long> latencies;
+
+	lock_guard<mutex> lock(mFanoutLock);
+	latencies.swap(mFanoutLatencyUs);
+	return latencies;
+}
+
+void TestClient::HandleRoomUserListResponse(RoomUserListResPacket* packet)
+{
+	if (packet->result != ErrorCode::SUCCESS)
+	{
+		mRoomUserListResult = packet->result;
+		mRoomUserListArrived = true;
+		return;
+	}
+
+	// firstIndex가 0이면 조회 응답의 첫 묶음, 아니면 입장 응답이나 앞 묶음에 이어지는 묶음이다
+	bool continuation = packet->firstIndex != 0;
+	if (!continuation)
+	{
+		mRoomUserListReceived = 0;
+		mRoomUserListTotal = packet->totalCount;
+	}
+
+	if (packet->firstIndex != mRoomUserListReceived || packet->totalCount != mRoomUserListTotal
+		|| packet->firstIndex + packet->userCount > mRoomUserListTotal)
+	{
+		cout << "[" << mName << "] RoomUserList chunk mismatch (index " << packet->firstIndex << "/" << mRoomUserListReceived
+			<< ", total " << packet->totalCount << "/" << mRoomUserListTotal << ")" << endl;
+		mRoomUserListReceived = 0;
+		mRoomUserListResult = ErrorCode::SERVER_ERROR;
+		mRoomUserListArrived = true;
+		return;
+	}
+
+	mRoomUserListReceived += packet->userCount;
+	if (continuation)
+		mRoomMemberCount += packet->userCount;
+
+	// 마지막 묶음에서 모은 수가 첫 묶음의 전체 인원과 같아야 완료다
+	if (mRoomUserListReceived == mRoomUserListTotal)
+	{
+		mRoomUserListReceived = 0;
+		mRoomUserCount = mRoomUserListTotal;
+		mRoomUserListResult = ErrorCode::SUCCESS;
+		mRoomUserListArrived = true;
+	}
+}
+
+void TestClient::HandleUserJoinNoti(UserJoinNotifyPacket* packet)
+{
+	if (packet->roomId == mCurrentRoomId)
+		mRoomMemberCount++;
+}
+
+void TestClient::HandleUserLeaveNoti(UserLeaveNotifyPacket* packet)
+{
+	if (packet->roomId == mCurrentRoomId)
+		mRoomMemberCount--;
+}
+
+void TestClient::HandleRoomSearchResponse(RoomSearchResPacket* packet)
+{
+	mSearchResult = packet->result;
+	if (packet->result == ErrorCode::SUCCESS)
+	{
+		mSearchTotalCount = packet->totalCount;
+	}
+	mSearchArrived = true;
+}
+
+void TestClient::HandleRoomHistoryNoti(RoomHistoryNotiPacket* packet)
+{
+	// 레코드: [uint8 nameLen][name][uint16 messageLen][message]
+	const char* pos = (const char*)packet + sizeof(RoomHistoryNotiPacket);
+	const char* end = (const char*)packet + packet->size;
+
+	int count = 0;
+	while (count < packet->messageCount && pos + sizeof(uint8_t) <= end)
+	{
+		uint8_t nameLen = *(const uint8_t*)pos;
+		pos += sizeof(uint8_t) + nameLen;
+
+		if (pos + sizeof(uint16_t) > end)
+			break;
+
+		uint16_t messageLen = *(const uint16_t*)pos;
+		pos += sizeof(uint16_t) + messageLen;
+
+		if (pos > end)
+			break;
+
+		count++;
+	}
+
+	mReceivedHistoryCount = count;
+}
@@ -1,11 +1,13 @@
 #pragma once
 #include <WinSock2.h>
 #include <string>
+#include <vector>
 #include <atomic>
+#include <mutex>
 #include <process.h>
 #include "../Common/Packet.h"
 
-#define MAX_SOCKBUF 2048
+#define MAX_SOCKBUF 8192	// 방 기록(가변 길이) 패킷까지 한 번에 담는다
 
 using namespace std;
 
@@ -19,17 +21,21 @@ public:
 	void Disconnect();
 	bool SendAll(SOCKET sock, const char* data, int totalSize);
 	bool Register(int num);
-	bool Login(int num);
+	bool Login(int num, int timeoutMs = 3000);
 	bool SendLobbyChat(const string& message);
 	bool SendWhisper(int targetId, const string& message);
 	// Room
 	bool CreateRoom(const string& name, uint16_t maxUser);
-	bool RequestRoomList(uint16_t page = 0);
-	bool JoinRoom(uint16_t roomId);
+	bool RequestRoomList(uint32_t cursor = 0);
+	bool JoinRoom(uint32_t roomId);
+	bool QuickJoin();
 	bool LeaveRoom();
 	bool SendRoomChat(const string& message);
+	bool RequestRoomUserList();
+	bool SearchRoom(const string& prefix, uint16_t page = 0);
 
 	bool IsAuthenticated() const { return mIsAuthenticated; }
+	int GetLoginRetryCount() const { return mLoginRetryCount; }
 	bool IsRunning() const { return mIsRunning; }
 	const string& GetName() const { return mName; }
 	int GetId() const { return mId; }
@@ -43,13 +49,22 @@ public:
 	void ResetAllCounts() { mReceivedLobbyChatCount = 0; mReceivedWhisperCount = 0; }
 
 	// Room getters
-	uint16_t GetCurrentRoomId() const { return mCurrentRoomId; }
+	uint32_t GetCurrentRoomId() const { return mCurrentRoomId; }
 
 	uint16_t GetRoomListCount() const { return mRoomListCount; }
 	RoomInfo GetRoomListEntry(int idx) const { return mRoomList[idx]; }
+	uint32_t GetRoomListNextCursor() const { return mRoomListNextCursor; }
+	uint16_t GetRoomUserCount() const { return mRoomUserCount; }
+	// 입장 시 받은 목록에 입장/퇴장 알림을 반영한 인원 수
+	int GetRoomMemberCount() const { return mRoomMemberCount; }
+	uint16_t GetSearchTotalCount() const { return mSearchTotalCount; }
+	int GetReceivedHistoryCount() const { return mReceivedHistoryCount; }
 	int GetReceivedRoomChatCount() const { return mReceivedRoomChatCount; }
 	void ResetRoomChatCount() { mReceivedRoomChatCount = 0; }
 
+	// "FANOUT <보낸 시각(ns)>" 채팅의 도착 지연(us). 가져가면 비워진다.
+	vector<long long> TakeFanoutLatencies();
+
 private:
 	static unsigned WINAPI RecvThreadFunc(void* arg);
 	void RecvLoop();
@@ -67,6 +82,11 @@ private:
 	void HandleLeaveRoomResponse(LeaveRoomResPacket* packet);
 	void HandleRoomChatResponse(RoomChatResPacket* packet);
 	void HandleRoomChatNoti(RoomChatNotiPacket* packet);
+	void HandleRoomUserListResponse(RoomUserListResPacket* packet);
+	void HandleRoomSearchResponse(RoomSearchResPacket* packet);
+	void HandleRoomHistoryNoti(RoomHistoryNotiPacket* packet);
+	void HandleUserJoinNoti(UserJoinNotifyPacket* packet);
+	void HandleUserLeaveNoti(UserLeaveNotifyPacket* packet);
 
 private:
 	int mId;
@@ -78,6 +98,10 @@ private:
 
 	atomic<bool> mIsRunning;
 	atomic<bool> mIsAuthenticated;
+	atomic<bool> mLoginResponseArrived{ false };
+	atomic<ErrorCode> mLoginResult{ ErrorCode::SERVER_ERROR };
+	atomic<uint16_t> mLoginRetryAfterMs{ 0 };
+	atomic<int> mLoginRetryCount{ 0 };		// SERVER_BUSY로 다시 보낸 횟수 (누적)
 	atomic<bool> mRegisterResponseArrived;
 	atomic<ErrorCode> mRegisterResult;
 
@@ -86,7 +110,7 @@ private:
 	atomic<int> mReceivedWhisperCount{ 0 };
 
 	// Room state
-	atomic<uint16_t> mCurrentRoomId{ INVALID_ROOM_ID };
+	atomic<uint32_t> mCurrentRoomId{ INVALID_ROOM_ID };
 
 	atomic<bool> mCreateRoomArrived{ false };
 	atomic<ErrorCode> mCreateRoomResult{ ErrorCode::SERVER_ERROR };
@@ -96,6 +120,7 @@ private:
 	atomic<ErrorCode> mRoomListResult{ ErrorCode::SERVER_ERROR };
 	uint16_t          mRoomListCount{ 0 };
 	RoomInfo          mRoomList[MAX_ROOM_PAGE_COUNT];
+	uint32_t          mRoomListNextCursor{ INVALID_ROOM_ID };
 
 	atomic<bool> mJoinRoomArrived{ false };
 	atomic<ErrorCode> mJoinRoomResult{ ErrorCode::SERVER_ERROR };
@@ -103,5 +128,23 @@ private:
 	atomic<bool> mLeaveRoomArrived{ false };
 	atomic<ErrorCode> mLeaveRoomResult{ ErrorCode::SERVER_ERROR };
 
+	atomic<bool> mRoomUserListArrived{ false };
+	atomic<ErrorCode> mRoomUserListResult{ ErrorCode::SERVER_ERROR };
+	atomic<uint16_t> mRoomUserCount{ 0 };
+	// 여러 패킷으로 나뉜 명단을 모으는 중인 상태 (수신 스레드 전용)
+	uint16_t mRoomUserListReceived{ 0 };	// 다음 묶음의 firstIndex여야 하는 값
+	uint16_t mRoomUserListTotal{ 0 };		// 첫 묶음이 알려준 전체 인원
+
+	atomic<int> mRoomMemberCount{ 0 };
+
+	atomic<bool> mSearchArrived{ false };
+	atomic<ErrorCode> mSearchResult{ ErrorCode::SERVER_ERROR };
+	atomic<uint16_t> mSearchTotalCount{ 0 };
+
+	atomic<int> mReceivedHistoryCount{ 0 };
+
 	atomic<int> mReceivedRoomChatCount{ 0 };
+
+	mutex mFanoutLock;
+	vector<long long> mFanoutLatencyUs;
 };
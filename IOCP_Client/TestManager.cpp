@@ -2,6 +2,7 @@
 #include <iostream>
 #include <thread>
 #include <algorithm>
+#include <ctime>
 
 TestManager::TestManager(const char* serverIP, int serverPort)
 	: mServerIP(serverIP)
@@ -164,6 +165,15 @@ bool TestManager::WaitForRoomChat(const vector<TestClient*>& roomClients, int ex
 	return false;
 }
 
+long long TestManager::Percentile(const vector<long long>& sorted, double p)
+{
+	if (sorted.empty())
+		return 0;
+
+	size_t idx = min(sorted.size() - 1, (size_t)(p * sorted.size()));
+	return sorted[idx];
+}
+
 void TestManager::SaveResultCSV(const string& filename, const string& header, const string& row)
 {
 	bool fileExists = false;
@@ -429,7 +439,7 @@ void TestManager::RoomTest()
 		return;
 	}
 
-	uint16_t roomId = mClients[0]->GetCurrentRoomId();
+	uint32_t roomId = mClients[0]->GetCurrentRoomId();
 	cout << "  Room ID: " << roomId << endl;
 
 	WaitForSeconds(1);
@@ -469,6 +479,10 @@ void TestManager::RoomTest()
 	}
 	cout << "  Room found in list: " << (roomFound ? "YES" : "NO") << endl;
 
+	bool searchOk = mClients[0]->SearchRoom("Game") && mClients[0]->GetSearchTotalCount() >= 1;
+	cout << "  Search 'Game': " << mClients[0]->GetSearchTotalCount() << " match(es) ("
+		<< (searchOk ? "OK" : "FAIL") << ")" << endl;
+
 	WaitForSeconds(1);
 
 	// Step 3: Client[1..N-1] 방 입장
@@ -484,6 +498,16 @@ void TestManager::RoomTest()
 	}
 	cout << "  Total in room: " << joinOkCount << " / " << mClients.size() << endl;
 
+	bool userListOk = mClients[0]->RequestRoomUserList()
+		&& mClients[0]->GetRoomUserCount() == joinOkCount;
+	cout << "  RoomUserList: " << mClients[0]->GetRoomUserCount() << " users ("
+		<< (userListOk ? "OK" : "MISMATCH") << ")" << endl;
+
+	// 방장은 목록을 다시 받지 않고 입장 알림만으로 명단을 맞춰야 한다
+	bool rosterOk = mClients[0]->GetRoomMemberCount() == joinOkCount;
+	cout << "  Roster by delta: " << mClients[0]->GetRoomMemberCount() << " users ("
+		<< (rosterOk ? "OK" : "MISMATCH") << ")" << endl;
+
 	WaitForSeconds(1);
 
 	// Step 4: 방 안의 모든 클라이언트가 채팅 전송
@@ -523,6 +547,21 @@ void TestManager::RoomTest()
 	cout << "  Received: " << totalRoomChatReceived << " / " << expectedRoomChat << endl;
 	cout << "  Room chat result: " << (chatOk ? "PASS" : "FAIL (timeout)") << endl;
 
+	// 나갔다 빠른 입장으로 돌아온 클라이언트는 빈자리가 생긴 이 방으로 들어가고 최근 대화를 받는다
+	TestClient* rejoiner = inRoom.back();
+	bool quickJoinOk = false;
+	bool historyOk = false;
+	if (inRoom.size() >= 2 && rejoiner->LeaveRoom() && rejoiner->QuickJoin())
+	{
+		quickJoinOk = rejoiner->GetCurrentRoomId() == roomId;
+		Sleep(200);
+		historyOk = rejoiner->GetReceivedHistoryCount() > 0;
+	}
+	cout << "  Quick join: room " << rejoiner->GetCurrentRoomId() << " ("
+		<< (quickJoinOk ? "OK" : "FAIL") << ")" << endl;
+	cout << "  History on rejoin: " << rejoiner->GetReceivedHistoryCount() << " message(s) ("
+		<< (historyOk ? "OK" : "FAIL") << ")" << endl;
+
 	WaitForSeconds(1);
 
 	// Step 5: 모든 클라이언트 방 퇴장
@@ -546,3 +585,468 @@ void TestManager::RoomTest()
 	cout << "Leave room:    " << leaveOkCount << "/" << inRoom.size() << " left" << endl;
 	cout << "========================================\n" << endl;
 }
+
+// ============================================================
+// Multi Room Test
+// ============================================================
+void TestManager::RunMultiRoomTest(int roomCount, int messagesPerClient, int serverWorkers)
+{
+	cout << "\n========================================" << endl;
+	cout << "MULTI ROOM TEST" << endl;
+	cout << "Clients: " << mNumClients << ", Rooms: " << roomCount
+		<< ", Messages: " << messagesPerClient << ", Server workers: " << serverWorkers << endl;
+	cout << "========================================\n" << endl;
+
+	int usersPerRoom = (roomCount > 0) ? (int)mClients.size() / roomCount : 0;
+	if (usersPerRoom < 2)
+	{
+		cout << "[SKIP] Need at least " << roomCount * 2 << " clients for " << roomCount << " rooms" << endl;
+		return;
+	}
+	usersPerRoom = min(usersPerRoom, (int)MAX_ROOM_USER);
+
+	// Step 1: 방마다 첫 클라이언트가 방을 만들고 나머지가 입장
+	cout << "[Step 1] Creating " << roomCount << " rooms with " << usersPerRoom << " users each..." << endl;
+	vector<vector<TestClient*>> rooms(roomCount);
+	for (int r = 0; r < roomCount; r++)
+	{
+		TestClient* owner = mClients[r * usersPerRoom].get();
+		if (!owner->CreateRoom("BenchRoom" + to_string(r + 1), (uint16_t)usersPerRoom))
+			continue;
+
+		uint32_t roomId = owner->GetCurrentRoomId();
+		rooms[r].push_back(owner);
+
+		for (int u = 1; u < usersPerRoom; u++)
+		{
+			TestClient* client = mClients[r * usersPerRoom + u].get();
+			if (client->JoinRoom(roomId))
+				rooms[r].push_back(client);
+		}
+	}
+
+	int joinedCount = 0;
+	int expected = 0;
+	for (auto& members : rooms)
+	{
+		for (auto* client : members)
+			client->ResetRoomChatCount();
+
+		joinedCount += (int)members.size();
+		expected += (int)members.size() * (int)members.size() * messagesPerClient;
+	}
+	cout << "  Users in rooms: " << joinedCount << endl;
+
+	WaitForSeconds(1);
+
+	// Step 2: 방마다 스레드 하나씩 동시에 채팅 전송
+	cout << "\n[Step 2] All rooms chat at the same time..." << endl;
+	auto start = chrono::high_resolution_clock::now();
+
+	vector<thread> senders;
+	for (auto& members : rooms)
+	{
+		senders.emplace_back([&members, messagesPerClient]()
+		{
+			for (int msg = 0; msg < messagesPerClient; msg++)
+			{
+				for (auto* client : members)
+					client->SendRoomChat("Bench " + to_string(msg + 1));
+			}
+		});
+	}
+	for (auto& sender : senders)
+		sender.join();
+
+	auto sendEnd = chrono::high_resolution_clock::now();
+	auto sendMs = chrono::duration_cast<chrono::milliseconds>(sendEnd - start).count();
+	cout << "All sends completed in " << sendMs << "ms. Waiting for responses..." << endl;
+
+	vector<TestClient*> inRooms;
+	for (auto& members : rooms)
+		inRooms.insert(inRooms.end(), members.begin(), members.end());
+
+	bool allReceived = WaitForRoomChat(inRooms, expected, 60);
+
+	auto end = chrono::high_resolution_clock::now();
+	auto totalMs = chrono::duration_cast<chrono::milliseconds>(end - start).count();
+
+	int totalReceived = 0;
+	for (auto* client : inRooms)
+		totalReceived += client->GetReceivedRoomChatCount();
+
+	long long msgsPerSec = (totalMs > 0) ? (long long)totalReceived * 1000 / totalMs : 0;
+
+	cout << "\n=== MULTI ROOM STATISTICS ===" << endl;
+	cout << "Total received: " << totalReceived << " / " << expected << endl;
+	cout << "Send time: " << sendMs << "ms" << endl;
+	cout << "Total time: " << totalMs << "ms" << endl;
+	cout << "Throughput: " << msgsPerSec << " notis/sec" << endl;
+	cout << "Result: " << (allReceived ? "PASS" : "FAIL (timeout)") << endl;
+
+	string csvHeader = "server_workers,rooms,users_per_room,messages,expected,received,send_ms,total_ms,notis_per_sec,result";
+	string csvRow = to_string(serverWorkers) + ","
+		+ to_string(roomCount) + ","
+		+ to_string(usersPerRoom) + ","
+		+ to_string(messagesPerClient) + ","
+		+ to_string(expected) + ","
+		+ to_string(totalReceived) + ","
+		+ to_string(sendMs) + ","
+		+ to_string(totalMs) + ","
+		+ to_string(msgsPerSec) + ","
+		+ (allReceived ? "PASS" : "FAIL");
+	SaveResultCSV("multiroom_results.csv", csvHeader, csvRow);
+
+	// Step 3: 다음 측정을 위해 모두 퇴장
+	for (auto* client : inRooms)
+		client->LeaveRoom();
+
+	cout << "========================================\n" << endl;
+}
+
+void TestManager::RunLargeRoomFanoutTest(int memberCount, int messageCount, int serverWorkers)
+{
+	cout << "\n========================================" << endl;
+	cout << "LARGE ROOM FANOUT TEST" << endl;
+	cout << "Members: " << memberCount << ", Messages: " << messageCount
+		<< ", Server workers: " << serverWorkers << endl;
+	cout << "========================================\n" << endl;
+
+	if (memberCount < 2 || memberCount > (int)mClients.size() || memberCount > UINT16_MAX)
+	{
+		cout << "[SKIP] Need " << memberCount << " connected clients (have " << mClients.size() << ")" << endl;
+		return;
+	}
+
+	// Step 1: 방 하나에 memberCount명을 모은다
+	cout << "[Step 1] Filling one room with " << memberCount << " members..." << endl;
+	TestClient* owner = mClients[0].get();
+	if (!owner->CreateRoom("FanoutRoom", (uint16_t)memberCount))
+	{
+		cout << "[FAIL] CreateRoom" << endl;
+		return;
+	}
+
+	uint32_t roomId = owner->GetCurrentRoomId();
+	vector<TestClient*> members{ owner };
+	for (int i = 1; i < memberCount; i++)
+	{
+		TestClient* client = mClients[i].get();
+		if (client->JoinRoom(roomId))
+			members.push_back(client);
+
+		if (i % 1000 == 0)
+			cout << "  Joined: " << members.size() << endl;
+	}
+	cout << "  Users in room: " << members.size() << endl;
+
+	// 입장 알림이 다 퍼질 때까지 기다린 뒤 측정값을 비운다
+	WaitForSeconds(3);
+	for (auto* client : members)
+	{
+		client->ResetRoomChatCount();
+		client->TakeFanoutLatencies();
+	}
+
+	// Step 2: 방장이 시각을 담은 채팅을 간격을 두고 보낸다. 한 줄씩 팬아웃 지연을 잰다.
+	cout << "\n[Step 2] Owner sends " << messageCount << " timestamped messages..." << endl;
+	auto start = chrono::high_resolution_clock::now();
+
+	for (int msg = 0; msg < messageCount; msg++)
+	{
+		long long nowNs = chrono::duration_cast<chrono::nanoseconds>(
+			chrono::steady_clock::now().time_since_epoch()).count();
+		owner->SendRoomChat("FANOUT " + to_string(nowNs));
+		Sleep(50);
+	}
+
+	int expected = (int)members.size() * messageCount;
+	bool allReceived = WaitForRoomChat(members, expected, 120);
+
+	auto end = chrono::high_resolution_clock::now();
+	auto totalMs = chrono::duration_cast<chrono::milliseconds>(end - start).count();
+
+	vector<long long> latencies;
+	latencies.reserve(expected);
+	for (auto* client : members)
+	{
+		vector<long long> received = client->TakeFanoutLatencies();
+		latencies.insert(latencies.end(), received.begin(), received.end());
+	}
+	sort(latencies.begin(), latencies.end());
+
+	long long p50 = Percentile(latencies, 0.50);
+	long long p99 = Percentile(latencies, 0.99);
+	long long maxUs = latencies.empty() ? 0 : latencies.back();
+
+	cout << "\n=== FANOUT STATISTICS ===" << endl;
+	cout << "Total received: " << latencies.size() << " / " << expected << endl;
+	cout << "Latency p50: " << p50 << "us, p99: " << p99 << "us, max: " << maxUs << "us" << endl;
+	cout << "Total time: " << totalMs << "ms" << endl;
+	cout << "Result: " << (allReceived ? "PASS" : "FAIL (timeout)") << endl;
+
+	string csvHeader = "server_workers,members,messages,expected,received,p50_us,p99_us,max_us,result";
+	string csvRow = to_string(serverWorkers) + ","
+		+ to_string(members.size()) + ","
+		+ to_string(messageCount) + ","
+		+ to_string(expected) + ","
+		+ to_string(latencies.size()) + ","
+		+ to_string(p50) + ","
+		+ to_string(p99) + ","
+		+ to_string(maxUs) + ","
+		+ (allReceived ? "PASS" : "FAIL");
+	SaveResultCSV("fanout_results.csv", csvHeader, csvRow);
+
+	// Step 3: 다음 측정을 위해 모두 퇴장
+	for (auto* client : members)
+		client->LeaveRoom();
+
+	cout << "========================================\n" << endl;
+}
+
+// ============================================================
+// Login Storm Test
+// ============================================================
+void TestManager::RunLoginStormTest(int stormCount, int serverWorkers)
+{
+	cout << "\n========================================" << endl;
+	cout << "LOGIN STORM TEST" << endl;
+	cout << "Storm clients: " << stormCount << ", Server workers: " << serverWorkers << endl;
+	cout << "========================================\n" << endl;
+
+	if (mClients.size() < 2 || stormCount < 1)
+	{
+		cout << "[SKIP] Need at least 2 logged-in clients as chat probes" << endl;
+		return;
+	}
+
+	// 기존 접속자와 아이디가 겹치지 않게 번호를 띄운다
+	const int stormBase = 100000;
+	const int loginsPerThread = 20;
+
+	// Step 1: 폭주에 쓸 계정을 미리 만든다 (측정 밖)
+	cout << "[Step 1] Preparing " << stormCount << " storm accounts..." << endl;
+	vector<unique_ptr<TestClient>> stormClients;
+	for (int i = 0; i < stormCount; i++)
+	{
+		int num = stormBase + i;
+		auto client = make_unique<TestClient>(num, "StormUser" + to_string(i + 1), mServerIP, mServerPort);
+		if (client->Connect() && client->Register(num))
+			stormClients.push_back(move(client));
+	}
+	cout << "  Ready: " << stormClients.size() << " / " << stormCount << endl;
+
+	// Step 2: 두 클라이언트로 작은 방을 만들어 채팅 지연 기준값을 잰다
+	TestClient* sender = mClients[0].get();
+	TestClient* receiver = mClients[1].get();
+	if (!sender->CreateRoom("LatencyProbe", 2) || !receiver->JoinRoom(sender->GetCurrentRoomId()))
+	{
+		cout << "[FAIL] Probe room setup" << endl;
+		return;
+	}
+
+	auto sendProbe = [sender]()
+	{
+		long long nowNs = chrono::duration_cast<chrono::nanoseconds>(
+			chrono::steady_clock::now().time_since_epoch()).count();
+		sender->SendRoomChat("FANOUT " + to_string(nowNs));
+	};
+
+	cout << "\n[Step 2] Measuring idle chat latency..." << endl;
+	receiver->TakeFanoutLatencies();
+	for (int i = 0; i < 100; i++)
+	{
+		sendProbe();
+		Sleep(10);
+	}
+	Sleep(500);
+	vector<long long> idleLatencies = receiver->TakeFanoutLatencies();
+	sort(idleLatencies.begin(), idleLatencies.end());
+
+	// Step 3: 스레드 여러 개로 동시에 로그인하면서 같은 간격으로 채팅 지연을 잰다
+	cout << "\n[Step 3] Login storm with " << stormClients.size() << " clients..." << endl;
+	atomic<int> finishedThreads{ 0 };
+	atomic<int> loginOkCount{ 0 };
+	vector<vector<long long>> loginLatencies((stormClients.size() + loginsPerThread - 1) / loginsPerThread);
+
+	auto start = chrono::high_resolution_clock::now();
+
+	vector<thread> stormThreads;
+	for (size_t t = 0; t < loginLatencies.size(); t++)
+	{
+		stormThreads.emplace_back([&, t]()
+		{
+			size_t first = t * loginsPerThread;
+			size_t last = min(first + loginsPerThread, stormClients.size());
+			for (size_t i = first; i < last; i++)
+			{
+				auto loginStart = chrono::high_resolution_clock::now();
+				if (stormClients[i]->Login(stormClients[i]->GetId(), 30000))
+				{
+					loginOkCount++;
+					loginLatencies[t].push_back(chrono::duration_cast<chrono::milliseconds>(
+						chrono::high_resolution_clock::now() - loginStart).count());
+				}
+			}
+			finishedThreads++;
+		});
+	}
+
+	while (finishedThreads < (int)stormThreads.size())
+	{
+		sendProbe();
+		Sleep(10);
+	}
+
+	auto end = chrono::high_resolution_clock::now();
+	for (auto& stormThread : stormThreads)
+		stormThread.join();
+
+	Sleep(500);
+	vector<long long> stormLatencies = receiver->TakeFanoutLatencies();
+	sort(stormLatencies.begin(), stormLatencies.end());
+
+	vector<long long> loginMs;
+	for (auto& latencies : loginLatencies)
+		loginMs.insert(loginMs.end(), latencies.begin(), latencies.end());
+	sort(loginMs.begin(), loginMs.end());
+
+	auto totalMs = chrono::duration_cast<chrono::milliseconds>(end - start).count();
+	long long loginsPerSec = (totalMs > 0) ? (long long)loginOkCount * 1000 / totalMs : 0;
+	bool allLoggedIn = loginOkCount == (int)stormClients.size();
+
+	// 서버가 SERVER_BUSY로 돌려보내 다시 보낸 횟수
+	int busyRetries = 0;
+	for (auto& client : stormClients)
+		busyRetries += client->GetLoginRetryCount();
+
+	cout << "\n=== LOGIN STORM STATISTICS ===" << endl;
+	cout << "Logins: " << loginOkCount << " / " << stormClients.size() << " in " << totalMs << "ms ("
+		<< loginsPerSec << " logins/sec)" << endl;
+	cout << "Login latency p50: " << Percentile(loginMs, 0.50) << "ms, p99: " << Percentile(loginMs, 0.99) << "ms" << endl;
+	cout << "Busy retries: " << busyRetries << endl;
+	cout << "Chat latency idle  p50: " << Percentile(idleLatencies, 0.50) << "us, p99: "
+		<< Percentile(idleLatencies, 0.99) << "us" << endl;
+	cout << "Chat latency storm p50: " << Percentile(stormLatencies, 0.50) << "us, p99: "
+		<< Percentile(stormLatencies, 0.99) << "us (" << stormLatencies.size() << " samples)" << endl;
+	cout << "Result: " << (allLoggedIn ? "PASS" : "FAIL") << endl;
+
+	string csvHeader = "server_workers,storm_clients,logins_ok,total_ms,logins_per_sec,login_p50_ms,login_p99_ms,"
+		"idle_chat_p50_us,idle_chat_p99_us,storm_chat_p50_us,storm_chat_p99_us,busy_retries,result";
+	string csvRow = to_string(serverWorkers) + ","
+		+ to_string(stormClients.size()) + ","
+		+ to_string(loginOkCount) + ","
+		+ to_string(totalMs) + ","
+		+ to_string(loginsPerSec) + ","
+		+ to_string(Percentile(loginMs, 0.50)) + ","
+		+ to_string(Percentile(loginMs, 0.99)) + ","
+		+ to_string(Percentile(idleLatencies, 0.50)) + ","
+		+ to_string(Percentile(idleLatencies, 0.99)) + ","
+		+ to_string(Percentile(stormLatencies, 0.50)) + ","
+		+ to_string(Percentile(stormLatencies, 0.99)) + ","
+		+ to_string(busyRetries) + ","
+		+ (allLoggedIn ? "PASS" : "FAIL");
+	SaveResultCSV("login_storm_results.csv", csvHeader, csvRow);
+
+	// Step 4: 정리
+	receiver->LeaveRoom();
+	sender->LeaveRoom();
+	for (auto& client : stormClients)
+		client->Disconnect();
+
+	cout << "========================================\n" << endl;
+}
+
+void TestManager::RunRegisterBurstTest(int registerCount, bool serverBatching)
+{
+	cout << "\n========================================" << endl;
+	cout << "REGISTER BURST TEST" << endl;
+	cout << "Registrations: " << registerCount << ", Server batching: " << (serverBatching ? "ON" : "OFF") << endl;
+	cout << "========================================\n" << endl;
+
+	if (registerCount < 1)
+	{
+		cout << "[SKIP] Need at least 1 registration" << endl;
+		return;
+	}
+
+	// 실행마다 새 아이디를 쓰도록 시각으로 번호를 띄운다 (중복 가입은 개별 INSERT로 빠져 결과가 달라진다)
+	const int idBase = 1000000 + (int)(time(nullptr) % 1000) * 100000;
+	const int registersPerThread = 20;
+
+	// Step 1: 접속만 해 둔다 (측정 밖)
+	cout << "[Step 1] Connecting " << registerCount << " clients..." << endl;
+	vector<unique_ptr<TestClient>> burstClients;
+	for (int i = 0; i < registerCount; i++)
+	{
+		int num = idBase + i;
+		auto client = make_unique<TestClient>(num, "BurstUser" + to_string(i + 1), mServerIP, mServerPort);
+		if (client->Connect())
+			burstClients.push_back(move(client));
+	}
+	cout << "  Connected: " << burstClients.size() << " / " << registerCount << endl;
+
+	// Step 2: 스레드 여러 개로 동시에 가입한다
+	cout << "\n[Step 2] Registering..." << endl;
+	atomic<int> registerOkCount{ 0 };
+	vector<vector<long long>> registerLatencies((burstClients.size() + registersPerThread - 1) / registersPerThread);
+
+	auto start = chrono::high_resolution_clock::now();
+
+	vector<thread> burstThreads;
+	for (size_t t = 0; t < registerLatencies.size(); t++)
+	{
+		burstThreads.emplace_back([&, t]()
+		{
+			size_t first = t * registersPerThread;
+			size_t last = min(first + registersPerThread, burstClients.size());
+			for (size_t i = first; i < last; i++)
+			{
+				auto registerStart = chrono::high_resolution_clock::now();
+				if (burstClients[i]->Register(burstClients[i]->GetId()))
+				{
+					registerOkCount++;
+					registerLatencies[t].push_back(chrono::duration_cast<chrono::milliseconds>(
+						chrono::high_resolution_clock::now() - registerStart).count());
+				}
+			}
+		});
+	}
+
+	for (auto& burstThread : burstThreads)
+		burstThread.join();
+
+	auto end = chrono::high_resolution_clock::now();
+
+	vector<long long> registerMs;
+	for (auto& latencies : registerLatencies)
+		registerMs.insert(registerMs.end(), latencies.begin(), latencies.end());
+	sort(registerMs.begin(), registerMs.end());
+
+	auto totalMs = chrono::duration_cast<chrono::milliseconds>(end - start).count();
+	long long insertsPerSec = (totalMs > 0) ? (long long)registerOkCount * 1000 / totalMs : 0;
+	bool allRegistered = registerOkCount == (int)burstClients.size();
+
+	cout << "\n=== REGISTER BURST STATISTICS ===" << endl;
+	cout << "Registrations: " << registerOkCount << " / " << burstClients.size() << " in " << totalMs << "ms ("
+		<< insertsPerSec << " inserts/sec)" << endl;
+	cout << "Register latency p50: " << Percentile(registerMs, 0.50) << "ms, p99: " << Percentile(registerMs, 0.99) << "ms" << endl;
+	cout << "Result: " << (allRegistered ? "PASS" : "FAIL") << endl;
+
+	string csvHeader = "server_batching,registrations,registered_ok,total_ms,inserts_per_sec,register_p50_ms,register_p99_ms,result";
+	string csvRow = string(serverBatching ? "on" : "off") + ","
+		+ to_string(burstClients.size()) + ","
+		+ to_string(registerOkCount) + ","
+		+ to_string(totalMs) + ","
+		+ to_string(insertsPerSec) + ","
+		+ to_string(Percentile(registerMs, 0.50)) + ","
+		+ to_string(Percentile(registerMs, 0.99)) + ","
+		+ (allRegistered ? "PASS" : "FAIL");
+	SaveResultCSV("register_burst_results.csv", csvHeader, csvRow);
+
+	// Step 3: 정리
+	for (auto& client : burstClients)
+		client->Disconnect();
+
+	cout << "========================================\n" << endl;
+}
@@ -19,6 +19,10 @@ public:
 	void RunMixedTest();
 	void RunPerformanceTest();
 	void RoomTest();
+	void RunMultiRoomTest(int roomCount, int messagesPerClient, int serverWorkers);
+	void RunLargeRoomFanoutTest(int memberCount, int messageCount, int serverWorkers);
+	void RunLoginStormTest(int stormCount, int serverWorkers);
+	void RunRegisterBurstTest(int registerCount, bool serverBatching);
 
 private:
 	void CreateClients();
@@ -32,6 +36,8 @@ private:
 	bool WaitForWhisper(int expected, int timeoutSec);
 	bool WaitForRoomChat(const vector<TestClient*>& roomClients, int expected, int timeoutSec);
 	void SaveResultCSV(const string& filename, const string& header, const string& row);
+	// 정렬된 값에서 p (0~1) 위치
+	static long long Percentile(const vector<long long>& sorted, double p);
 
 private:
 	const char* mServerIP;
@@ -0,0 +1,212 @@
+#include "AdmissionQueue.h"
+#include "SRWLockGuard.h"
+#include <algorithm>
+#include <vector>
+#include <iostream>
+
+AdmissionQueue::AdmissionQueue(uint32_t maxInFlight, size_t queueLimit, uint32_t queueTimeoutMs)
+	: mMaxInFlight(max(maxInFlight, 1u))
+	, mQueueLimit(queueLimit)
+	, mQueueTimeout(queueTimeoutMs)
+	, mInFlight(0)
+	, mAvgServiceUs(0.0)
+	, mExpiryTimer(nullptr)
+{
+	InitializeSRWLock(&mLock);
+
+	// 자리가 한동안 나지 않으면 PassSlot만으로는 대기자가 만료되지 않으므로 타이머로도 걷어 낸다
+	if (!CreateTimerQueueTimer(&mExpiryTimer, nullptr, OnExpiryTimer, this,
+		ADMISSION_EXPIRY_INTERVAL_MS, ADMISSION_EXPIRY_INTERVAL_MS, WT_EXECUTEDEFAULT))
+	{
+		cout << "[AdmissionQueue] CreateTimerQueueTimer failed: " << GetLastError() << endl;
+		mExpiryTimer = nullptr;
+	}
+}
+
+AdmissionQueue::~AdmissionQueue()
+{
+	Stop();
+}
+
+void AdmissionQueue::Stop()
+{
+	if (mExpiryTimer == nullptr)
+		return;
+
+	// INVALID_HANDLE_VALUE: 이미 돌고 있는 콜백이 끝날 때까지 기다린다
+	DeleteTimerQueueTimer(nullptr, mExpiryTimer, INVALID_HANDLE_VALUE);
+	mExpiryTimer = nullptr;
+}
+
+bool AdmissionQueue::Admit(StartFunc start, RejectFunc reject, uint32_t& retryAfterMs)
+{
+	{
+		SRWLockGuard lock(&mLock);
+
+		if (mInFlight >= mMaxInFlight)
+		{
+			if (mWaiters.size() >= mQueueLimit)
+			{
+				mStats.rejected++;
+				retryAfterMs = EstimateRetryAfterMs();
+				return false;
+			}
+
+			mWaiters.push_back({ move(start), move(reject), chrono::steady_clock::now() });
+			mStats.queued++;
+			mStats.maxQueueDepth = max(mStats.maxQueueDepth, mWaiters.size());
+			return true;
+		}
+
+		mInFlight++;
+	}
+
+	switch (RunStart(start))
+	{
+	case AdmissionStart::STARTED:
+		return true;
+
+	case AdmissionStart::CANCELLED:
+		PassSlot();
+		return true;
+
+	default:
+		// 하위 실행기가 받지 못했다. 자리는 다음 대기자에게 넘기고 이 요청은 부른 쪽이 거절한다
+		retryAfterMs = GetRetryAfterMs();
+		PassSlot();
+		return false;
+	}
+}
+
+AdmissionStart AdmissionQueue::RunStart(const StartFunc& start)
+{
+	AdmissionStart result = start();
+
+	SRWLockGuard lock(&mLock);
+	if (result == AdmissionStart::STARTED)
+		mStats.started++;
+	else if (result == AdmissionStart::CANCELLED)
+		mStats.cancelled++;
+
+	return result;
+}
+
+void AdmissionQueue::Release(uint64_t serviceUs)
+{
+	{
+		SRWLockGuard lock(&mLock);
+
+		mStats.completed++;
+		mStats.totalServiceUs += serviceUs;
+		mAvgServiceUs = (mAvgServiceUs == 0.0) ? (double)serviceUs : mAvgServiceUs * 0.9 + serviceUs * 0.1;
+	}
+
+	PassSlot();
+}
+
+void AdmissionQueue::PassSlot()
+{
+	while (true)
+	{
+		Waiter waiter;
+		bool expired = false;
+		uint32_t retryAfterMs = 0;
+		{
+			SRWLockGuard lock(&mLock);
+
+			if (mWaiters.empty())
+			{
+				mInFlight--;
+				return;
+			}
+
+			waiter = move(mWaiters.front());
+			mWaiters.pop_front();
+
+			auto waited = chrono::steady_clock::now() - waiter.enqueuedAt;
+			mStats.totalQueueWaitUs += chrono::duration_cast<chrono::microseconds>(waited).count();
+
+			// 클라이언트가 이미 포기했을 만큼 기다린 요청은 시작하지 않는다
+			expired = waited > mQueueTimeout;
+			if (expired)
+			{
+				mStats.expired++;
+				retryAfterMs = EstimateRetryAfterMs();
+			}
+		}
+
+		if (!expired)
+		{
+			AdmissionStart result = RunStart(waiter.start);
+			if (result == AdmissionStart::STARTED)
+				return;
+
+			// 세션이 없어 시작하지 않았다. 보낼 곳이 없으니 거절 없이 다음 대기자로
+			if (result == AdmissionStart::CANCELLED)
+				continue;
+
+			retryAfterMs = GetRetryAfterMs();
+		}
+
+		waiter.reject(retryAfterMs);
+	}
+}
+
+void AdmissionQueue::ExpireWaiters()
+{
+	vector<Waiter> expired;
+	uint32_t retryAfterMs = 0;
+	{
+		SRWLockGuard lock(&mLock);
+
+		// 들어온 순서대로 쌓이므로 앞에서부터 만료되지 않은 대기자를 만나면 멈춘다
+		auto now = chrono::steady_clock::now();
+		while (!mWaiters.empty() && now - mWaiters.front().enqueuedAt > mQueueTimeout)
+		{
+			auto waited = now - mWaiters.front().enqueuedAt;
+			mStats.totalQueueWaitUs += chrono::duration_cast<chrono::microseconds>(waited).count();
+			mStats.expired++;
+
+			expired.push_back(move(mWaiters.front()));
+			mWaiters.pop_front();
+		}
+
+		if (expired.empty())
+			return;
+
+		retryAfterMs = EstimateRetryAfterMs();
+	}
+
+	for (auto& waiter : expired)
+		waiter.reject(retryAfterMs);
+}
+
+VOID CALLBACK AdmissionQueue::OnExpiryTimer(PVOID context, BOOLEAN timerFired)
+{
+	static_cast<AdmissionQueue*>(context)->ExpireWaiters();
+}
+
+uint32_t AdmissionQueue::GetRetryAfterMs()
+{
+	SRWLockGuard lock(&mLock, false);
+	return EstimateRetryAfterMs();
+}
+
+uint32_t AdmissionQueue::EstimateRetryAfterMs() const
+{
+	// 밀린 요청이 모두 빠지는 데 걸릴 시간 = (대기 수 / 동시 실행 수) x 평균 처리 시간
+	double drainUs = (double)(mWaiters.size() + 1) / mMaxInFlight * mAvgServiceUs;
+	uint32_t retryAfterMs = (uint32_t)(drainUs / 1000.0);
+
+	return min(max(retryAfterMs, (uint32_t)ADMISSION_RETRY_AFTER_MIN_MS), (uint32_t)ADMISSION_RETRY_AFTER_MAX_MS);
+}
+
+AdmissionStats AdmissionQueue::GetStats()
+{
+	SRWLockGuard lock(&mLock, false);
+
+	AdmissionStats stats = mStats;
+	stats.inFlight = mInFlight;
+	stats.queueDepth = mWaiters.size();
+	return stats;
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <Windows.h>
+#include <deque>
+#include <atomic>
+#include <chrono>
+#include <functional>
+
+#define ADMISSION_RETRY_AFTER_MIN_MS 100		// 거절할 때 알려 주는 재시도 대기 하한
+#define ADMISSION_RETRY_AFTER_MAX_MS 5000
+#define ADMISSION_EXPIRY_INTERVAL_MS 100		// 줄 앞쪽에서 시간이 지난 대기자를 걷어 내는 타이머 주기
+
+using namespace std;
+
+enum class AdmissionStart
+{
+	STARTED,	// 하위 실행기로 넘겼다. 끝나면 Release를 부른다
+	BUSY,		// 하위 실행기가 받지 못했다. 거절한다
+	CANCELLED,	// 요청한 세션이 이미 없다. 응답 없이 자리만 다음 대기자에게 넘긴다
+};
+
+struct AdmissionStats
+{
+	uint32_t inFlight = 0;
+	size_t queueDepth = 0;
+	size_t maxQueueDepth = 0;
+	uint64_t started = 0;			// 바로 또는 줄을 선 뒤 시작한 수
+	uint64_t queued = 0;			// 자리가 없어 줄을 선 수
+	uint64_t rejected = 0;			// 줄도 가득 차서 바로 거절한 수
+	uint64_t expired = 0;			// 줄에서 너무 오래 기다려 거절한 수
+	uint64_t cancelled = 0;			// 시작할 차례에 세션이 이미 끊겨 건너뛴 수
+	uint64_t completed = 0;
+	uint64_t totalQueueWaitUs = 0;	// 줄에서 기다린 시간 합 (queued 기준)
+	uint64_t totalServiceUs = 0;	// 시작부터 Release까지 시간 합 (completed 기준)
+};
+
+// 동시에 진행할 수 있는 작업 수를 maxInFlight로 묶는 입장 대기열.
+// 자리가 있으면 Admit에서 바로 시작하고, 없으면 queueLimit까지 줄을 세웠다가 Release 때 하나씩 시작한다.
+// 줄도 가득 차면 지금 밀린 양으로 계산한 재시도 시간과 함께 거절한다.
+// 자리가 나지 않아도 타이머가 queueTimeout을 넘긴 대기자를 주기적으로 거절한다.
+class AdmissionQueue
+{
+public:
+	// STARTED일 때만 나중에 Release를 부른다
+	using StartFunc = function<AdmissionStart()>;
+	// 줄에서 밀려났을 때 재시도 시간과 함께 불린다. Release를 부른 스레드나 타이머 스레드에서 실행된다
+	using RejectFunc = function<void(uint32_t retryAfterMs)>;
+
+	AdmissionQueue(uint32_t maxInFlight, size_t queueLimit, uint32_t queueTimeoutMs);
+	~AdmissionQueue();
+
+	AdmissionQueue(const AdmissionQueue&) = delete;
+	AdmissionQueue& operator=(const AdmissionQueue&) = delete;
+
+	// 바로 시작하거나(취소 포함) 줄을 세우면 true. false면 reject는 불리지 않으니 부른 쪽이 retryAfterMs로 거절한다
+	bool Admit(StartFunc start, RejectFunc reject, uint32_t& retryAfterMs);
+
+	// 시작한 작업 하나가 끝날 때 (성공/실패 무관) 한 번 부른다. 자리를 다음 대기자에게 넘긴다
+	void Release(uint64_t serviceUs);
+
+	// 만료 타이머를 멈춘다. 진행 중인 콜백이 끝날 때까지 기다린다
+	void Stop();
+
+	uint32_t GetRetryAfterMs();
+	AdmissionStats GetStats();
+
+private:
+	struct Waiter
+	{
+		StartFunc start;
+		RejectFunc reject;
+		chrono::steady_clock::time_point enqueuedAt;
+	};
+
+	// 자리 하나를 가진 채로 호출. 다음 대기자를 시작하거나 대기자가 없으면 자리를 반납한다
+	void PassSlot();
+	// 자리를 가진 채로 start를 부르고 결과를 센다
+	AdmissionStart RunStart(const StartFunc& start);
+	// 줄 앞에서부터 queueTimeout을 넘긴 대기자를 빼서 거절한다
+	void ExpireWaiters();
+	static VOID CALLBACK OnExpiryTimer(PVOID context, BOOLEAN timerFired);
+	uint32_t EstimateRetryAfterMs() const;	// mLock 안에서
+
+private:
+	const uint32_t mMaxInFlight;
+	const size_t mQueueLimit;
+	const chrono::milliseconds mQueueTimeout;
+
+	SRWLOCK mLock;
+	deque<Waiter> mWaiters;		// mLock
+	uint32_t mInFlight;			// mLock
+	double mAvgServiceUs;		// mLock, 최근 작업 위주의 이동 평균
+	AdmissionStats mStats;		// mLock
+	HANDLE mExpiryTimer;
+};
@@ -0,0 +1,80 @@
+#include "BufferPool.h"
+#include "SRWLockGuard.h"
+#include <algorithm>
+
+BufferPool::BufferPool(size_t blockSize, size_t blocksPerSlab)
+	: mBlockSize(blockSize)
+	, mBlocksPerSlab(blocksPerSlab)
+	, mInUseCount(0)
+{
+	InitializeSRWLock(&mSrwLock);
+}
+
+char* BufferPool::Acquire()
+{
+	SRWLockGuard lock(&mSrwLock);
+
+	if (mFreeBlocks.empty())
+		AddSlab();
+
+	char* block = mFreeBlocks.back();
+	mFreeBlocks.pop_back();
+	FindSlab(block).freeCount--;
+	mInUseCount++;
+
+	return block;
+}
+
+void BufferPool::Release(char* block)
+{
+	if (block == nullptr)
+		return;
+
+	SRWLockGuard lock(&mSrwLock);
+
+	mFreeBlocks.push_back(block);
+	mInUseCount--;
+
+	auto it = prev(mSlabs.upper_bound(block));
+	Slab& slab = it->second;
+
+	// 접속이 몰렸다 빠진 뒤에도 최대치만큼 잡고 있지 않도록, 여유가 한 슬랩 넘게 남을 때만 돌려준다
+	if (++slab.freeCount == mBlocksPerSlab && mFreeBlocks.size() > mBlocksPerSlab * 2)
+		TrimSlab(it->first);
+}
+
+size_t BufferPool::GetReservedBytes()
+{
+	SRWLockGuard lock(&mSrwLock, false);
+	return mSlabs.size() * mBlocksPerSlab * mBlockSize;
+}
+
+void BufferPool::AddSlab()
+{
+	auto memory = make_unique<char[]>(mBlockSize * mBlocksPerSlab);
+	char* base = memory.get();
+
+	mFreeBlocks.reserve(mFreeBlocks.size() + mBlocksPerSlab);
+	for (size_t i = 0; i < mBlocksPerSlab; ++i)
+	{
+		mFreeBlocks.push_back(base + i * mBlockSize);
+	}
+
+	mSlabs.emplace(base, Slab{ move(memory), mBlocksPerSlab });
+}
+
+BufferPool::Slab& BufferPool::FindSlab(char* block)
+{
+	return prev(mSlabs.upper_bound(block))->second;
+}
+
+// mSrwLock 안에서 호출. 슬랩의 블록을 여유 목록에서 모두 빼고 메모리를 해제한다
+void BufferPool::TrimSlab(char* base)
+{
+	char* end = base + mBlockSize * mBlocksPerSlab;
+
+	mFreeBlocks.erase(remove_if(mFreeBlocks.begin(), mFreeBlocks.end(),
+		[base, end](char* block) { return block >= base && block < end; }), mFreeBlocks.end());
+
+	mSlabs.erase(base);
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <Windows.h>
+#include <vector>
+#include <map>
+#include <memory>
+#include <atomic>
+
+using namespace std;
+
+// 고정 크기 블록을 슬랩 단위로 잡아두고 빌려주는 공용 버퍼 풀.
+// 세션은 실제로 주고받는 데이터가 있을 때만 블록을 빌리고, 다 쓰면 반납한다.
+// 슬랩이 통째로 비었는데 다른 여유 블록이 한 슬랩 넘게 남아 있으면 그 슬랩은 해제한다.
+class BufferPool
+{
+public:
+	BufferPool(size_t blockSize, size_t blocksPerSlab);
+	~BufferPool() = default;
+
+	BufferPool(const BufferPool&) = delete;
+	BufferPool& operator=(const BufferPool&) = delete;
+	BufferPool(BufferPool&&) = delete;
+	BufferPool& operator=(BufferPool&&) = delete;
+
+	char* Acquire();
+	void Release(char* block);
+
+	size_t GetBlockSize() const { return mBlockSize; }
+	size_t GetInUseCount() const { return mInUseCount; }
+	size_t GetReservedBytes();
+
+private:
+	struct Slab
+	{
+		unique_ptr<char[]> memory;
+		size_t freeCount;
+	};
+
+	void AddSlab();
+	Slab& FindSlab(char* block);
+	void TrimSlab(char* base);
+
+private:
+	const size_t mBlockSize;
+	const size_t mBlocksPerSlab;
+
+	map<char*, Slab> mSlabs;	// 시작 주소 순. 블록이 속한 슬랩을 upper_bound로 찾는다
+	vector<char*> mFreeBlocks;
+	atomic<size_t> mInUseCount;
+
+	SRWLOCK mSrwLock;
+};
@@ -0,0 +1,473 @@
+#include "ChatLog.h"
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+#include <malloc.h>
+#include <array>
+
+static string MakeSegmentPath(const string& directory, uint32_t index)
+{
+	char name[32];
+	sprintf_s(name, sizeof(name), "chat_%08u.log", index);
+	return directory + "\\" + name;
+}
+
+// IEEE 802.3 CRC32 (zlib crc32과 같은 값). 앞 조각의 결과를 crc로 넘기면 이어서 계산한다
+static uint32_t UpdateCrc32(uint32_t crc, const char* data, size_t size)
+{
+	static const auto table = []()
+	{
+		array<uint32_t, 256> values{};
+		for (uint32_t i = 0; i < 256; ++i)
+		{
+			uint32_t value = i;
+			for (int bit = 0; bit < 8; ++bit)
+				value = (value & 1) ? (value >> 1) ^ 0xEDB88320u : value >> 1;
+			values[i] = value;
+		}
+		return values;
+	}();
+
+	crc = ~crc;
+	for (size_t i = 0; i < size; ++i)
+		crc = table[(crc ^ static_cast<uint8_t>(data[i])) & 0xFF] ^ (crc >> 8);
+	return ~crc;
+}
+
+// crc 필드를 0으로 본 레코드 전체의 CRC32
+static uint32_t ComputeRecordCrc(const char* record, size_t size)
+{
+	ChatLogRecordHeader header;
+	memcpy(&header, record, sizeof(header));
+	header.crc = 0;
+
+	uint32_t crc = UpdateCrc32(0, reinterpret_cast<const char*>(&header), sizeof(header));
+	return UpdateCrc32(crc, record + sizeof(header), size - sizeof(header));
+}
+
+ChatLog::ChatLog()
+	: mPendingBytes(0)
+	, mWakeEvent(CreateEvent(nullptr, FALSE, FALSE, nullptr))
+	, mStopping(false)
+	, mFile(INVALID_HANDLE_VALUE)
+	, mSegmentBytes(0)
+	, mUnsyncedRecords(0)
+	, mUnsyncedBytes(0)
+	, mSequence(0)
+	, mDroppedWhileClosed(0)
+	, mAppended(0)
+	, mDropped(0)
+	, mWritten(0)
+	, mSynced(0)
+	, mSyncCount(0)
+	, mBytesWritten(0)
+	, mSegmentIndex(0)
+{
+	InitializeSListHead(&mQueue);
+}
+
+ChatLog::~ChatLog()
+{
+	Close();
+	FreeQueue();
+
+	if (mWakeEvent != nullptr)
+	{
+		CloseHandle(mWakeEvent);
+		mWakeEvent = nullptr;
+	}
+}
+
+bool ChatLog::Open(const string& directory)
+{
+	if (!CreateDirectoryA(directory.c_str(), nullptr) && GetLastError() != ERROR_ALREADY_EXISTS)
+	{
+		cout << "[ChatLog] CreateDirectory failed: " << GetLastError() << endl;
+		return false;
+	}
+
+	mDirectory = directory;
+
+	// 이전 실행의 마지막 세그먼트 끝은 잘렸을 수 있으므로 이어 쓰지 않고 다음 번호로 시작한다
+	uint32_t lastIndex = 0;
+	for (const string& path : ListSegments(directory))
+		lastIndex = max(lastIndex, (uint32_t)strtoul(path.c_str() + path.size() - 12, nullptr, 10));
+
+	if (!OpenSegment(lastIndex + 1))
+		return false;
+
+	mStopping = false;
+	mWriterThread = thread([this]() { WriterLoop(); });
+
+	cout << "[ChatLog] Writing " << MakeSegmentPath(mDirectory, mSegmentIndex) << endl;
+	return true;
+}
+
+void ChatLog::Close()
+{
+	if (!mWriterThread.joinable())
+		return;
+
+	mStopping = true;
+	SetEvent(mWakeEvent);
+	mWriterThread.join();
+
+	if (mFile != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(mFile);
+		mFile = INVALID_HANDLE_VALUE;
+	}
+
+	cout << "[ChatLog] synced " << mSynced << "/" << mAppended << " records, dropped " << mDropped
+		<< ", " << mSyncCount << " syncs" << endl;
+}
+
+bool ChatLog::Append(ChatLogType type, string_view sender, string_view target, uint32_t roomId, string_view message)
+{
+	if (mStopping)
+		return false;
+
+	sender = sender.substr(0, min(sender.size(), (size_t)UINT8_MAX));
+	target = target.substr(0, min(target.size(), (size_t)UINT8_MAX));
+	message = message.substr(0, min(message.size(), (size_t)UINT16_MAX));
+
+	uint32_t recordSize = (uint32_t)(sizeof(ChatLogRecordHeader) + sender.size() + target.size() + message.size());
+
+	// 기록이 밀려도 채팅은 기다리지 않는다. 넘치는 만큼은 버리고 센다
+	int64_t pending = mPendingBytes.fetch_add(recordSize) + recordSize;
+	if (pending > CHAT_LOG_QUEUE_LIMIT_BYTES)
+	{
+		mPendingBytes -= recordSize;
+		mDropped++;
+		return false;
+	}
+
+	// SLIST 노드는 MEMORY_ALLOCATION_ALIGNMENT 정렬이 필요하다
+	auto* entry = static_cast<Entry*>(_aligned_malloc(sizeof(Entry) + recordSize, MEMORY_ALLOCATION_ALIGNMENT));
+	if (entry == nullptr)
+	{
+		mPendingBytes -= recordSize;
+		mDropped++;
+		return false;
+	}
+
+	entry->size = recordSize;
+
+	// 순서 번호와 CRC는 기록 스레드가 파일에 쓰는 순서대로 채운다
+	ChatLogRecordHeader header{};
+	header.length = recordSize;
+	header.timestampMs = chrono::duration_cast<chrono::milliseconds>(
+		chrono::system_clock::now().time_since_epoch()).count();
+	header.roomId = roomId;
+	header.type = type;
+	header.senderLength = (uint8_t)sender.size();
+	header.targetLength = (uint8_t)target.size();
+	header.messageLength = (uint16_t)message.size();
+
+	char* data = reinterpret_cast<char*>(entry + 1);
+	memcpy(data, &header, sizeof(header));
+	data += sizeof(header);
+	memcpy(data, sender.data(), sender.size());
+	data += sender.size();
+	memcpy(data, target.data(), target.size());
+	data += target.size();
+	memcpy(data, message.data(), message.size());
+
+	InterlockedPushEntrySList(&mQueue, &entry->link);
+	mAppended++;
+
+	// 쌓인 양이 동기화 기준을 처음 넘을 때만 깨운다. 그 전에는 기록 스레드가 주기적으로 가져간다
+	if (pending >= CHAT_LOG_SYNC_BYTES && pending - recordSize < CHAT_LOG_SYNC_BYTES)
+		SetEvent(mWakeEvent);
+
+	return true;
+}
+
+ChatLogStats ChatLog::GetStats() const
+{
+	ChatLogStats stats;
+	stats.appended = mAppended;
+	stats.dropped = mDropped;
+	stats.written = mWritten;
+	stats.synced = mSynced;
+	stats.syncCount = mSyncCount;
+	stats.bytesWritten = mBytesWritten;
+	stats.segmentIndex = mSegmentIndex;
+	return stats;
+}
+
+void ChatLog::WriterLoop()
+{
+	vector<Entry*> batch;
+	vector<char> buffer;
+	buffer.reserve(CHAT_LOG_SYNC_BYTES);
+
+	auto lastSync = chrono::steady_clock::now();
+
+	while (true)
+	{
+		WaitForSingleObject(mWakeEvent, CHAT_LOG_SYNC_INTERVAL_MS);
+		bool stopping = mStopping;
+
+		// SLIST는 나중에 넣은 것이 앞에 오므로 뒤집어 넣은 순서로 쓴다
+		batch.clear();
+		for (PSLIST_ENTRY link = InterlockedFlushSList(&mQueue); link != nullptr; link = link->Next)
+			batch.push_back(CONTAINING_RECORD(link, Entry, link));
+		reverse(batch.begin(), batch.end());
+
+		// 세그먼트를 바꾸다 실패했으면 잠시 간격을 두고 다시 열어 본다
+		if (mFile == INVALID_HANDLE_VALUE && !batch.empty() && chrono::steady_clock::now() >= mReopenAt)
+		{
+			if (OpenSegment(mSegmentIndex + 1))
+			{
+				cout << "[ChatLog] Reopened " << MakeSegmentPath(mDirectory, mSegmentIndex)
+					<< " after dropping " << mDroppedWhileClosed << " records" << endl;
+				mDroppedWhileClosed = 0;
+			}
+			else
+			{
+				mReopenAt = chrono::steady_clock::now() + chrono::milliseconds(CHAT_LOG_REOPEN_INTERVAL_MS);
+			}
+		}
+
+		uint64_t records = 0;
+		for (Entry* entry : batch)
+		{
+			if (mFile != INVALID_HANDLE_VALUE && mSegmentBytes > 0 && mSegmentBytes + entry->size > CHAT_LOG_SEGMENT_BYTES)
+			{
+				WriteBuffer(buffer, records);
+				records = 0;
+				Sync();
+
+				CloseHandle(mFile);
+				mFile = INVALID_HANDLE_VALUE;
+
+				if (!OpenSegmentWithRetry(mSegmentIndex + 1))
+				{
+					cout << "[ChatLog] Segment rotation failed, dropping records until "
+						<< MakeSegmentPath(mDirectory, mSegmentIndex + 1) << " opens" << endl;
+					mReopenAt = chrono::steady_clock::now() + chrono::milliseconds(CHAT_LOG_REOPEN_INTERVAL_MS);
+				}
+			}
+
+			char* data = reinterpret_cast<char*>(entry + 1);
+			SealRecord(data, entry->size);
+			buffer.insert(buffer.end(), data, data + entry->size);
+			mSegmentBytes += entry->size;
+			records++;
+
+			mPendingBytes -= entry->size;
+			_aligned_free(entry);
+
+			if (buffer.size() >= CHAT_LOG_SYNC_BYTES)
+			{
+				WriteBuffer(buffer, records);
+				records = 0;
+			}
+		}
+
+		WriteBuffer(buffer, records);
+
+		auto now = chrono::steady_clock::now();
+		if (mUnsyncedRecords > 0 &&
+			(stopping || mUnsyncedBytes >= CHAT_LOG_SYNC_BYTES ||
+			 now - lastSync >= chrono::milliseconds(CHAT_LOG_SYNC_INTERVAL_MS)))
+		{
+			Sync();
+			lastSync = now;
+		}
+
+		// 멈출 때는 깨우기 직전까지 들어온 레코드를 모두 쓴 뒤 나간다
+		if (stopping && QueryDepthSList(&mQueue) == 0)
+			break;
+	}
+}
+
+void ChatLog::SealRecord(char* record, uint32_t size)
+{
+	auto* header = reinterpret_cast<ChatLogRecordHeader*>(record);
+	header->sequence = mSequence++;
+	header->crc = ComputeRecordCrc(record, size);
+}
+
+bool ChatLog::OpenSegmentWithRetry(uint32_t index)
+{
+	for (int attempt = 0; attempt < CHAT_LOG_OPEN_RETRIES; ++attempt)
+	{
+		if (attempt > 0)
+			Sleep(CHAT_LOG_OPEN_RETRY_MS);
+
+		if (OpenSegment(index))
+			return true;
+	}
+
+	return false;
+}
+
+bool ChatLog::OpenSegment(uint32_t index)
+{
+	string path = MakeSegmentPath(mDirectory, index);
+
+	// 읽기 도구가 기록 중인 세그먼트도 매핑할 수 있도록 읽기 공유를 연다
+	mFile = CreateFileA(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+		CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+	if (mFile == INVALID_HANDLE_VALUE)
+	{
+		cout << "[ChatLog] CreateFile failed: " << path << ", " << GetLastError() << endl;
+		return false;
+	}
+
+	mSegmentIndex = index;
+	mSegmentBytes = 0;
+	return true;
+}
+
+void ChatLog::WriteBuffer(vector<char>& buffer, uint64_t records)
+{
+	if (buffer.empty())
+		return;
+
+	// 세그먼트를 못 연 동안에는 버린 수만 모아 두고, 다시 열릴 때 한 번에 남긴다
+	if (mFile == INVALID_HANDLE_VALUE)
+	{
+		mDropped += records;
+		mDroppedWhileClosed += records;
+		buffer.clear();
+		return;
+	}
+
+	DWORD written = 0;
+	if (!WriteFile(mFile, buffer.data(), (DWORD)buffer.size(), &written, nullptr) || written != buffer.size())
+	{
+		cout << "[ChatLog] WriteFile failed: " << GetLastError() << endl;
+		mDropped += records;
+		buffer.clear();
+		return;
+	}
+
+	mWritten += records;
+	mBytesWritten += written;
+	mUnsyncedRecords += records;
+	mUnsyncedBytes += written;
+	buffer.clear();
+}
+
+void ChatLog::Sync()
+{
+	if (mUnsyncedRecords == 0 || mFile == INVALID_HANDLE_VALUE)
+		return;
+
+	// 여러 번의 쓰기를 한 번의 동기화로 묶는다
+	if (!FlushFileBuffers(mFile))
+	{
+		cout << "[ChatLog] FlushFileBuffers failed: " << GetLastError() << endl;
+		return;
+	}
+
+	mSynced += mUnsyncedRecords;
+	mSyncCount++;
+	mUnsyncedRecords = 0;
+	mUnsyncedBytes = 0;
+}
+
+void ChatLog::FreeQueue()
+{
+	PSLIST_ENTRY link = InterlockedFlushSList(&mQueue);
+	while (link != nullptr)
+	{
+		PSLIST_ENTRY next = link->Next;
+		_aligned_free(CONTAINING_RECORD(link, Entry, link));
+		link = next;
+	}
+}
+
+vector<string> ChatLog::ListSegments(const string& directory)
+{
+	vector<string> paths;
+
+	WIN32_FIND_DATAA findData;
+	HANDLE find = FindFirstFileA((directory + "\\chat_*.log").c_str(), &findData);
+	if (find == INVALID_HANDLE_VALUE)
+		return paths;
+
+	do
+	{
+		paths.push_back(directory + "\\" + findData.cFileName);
+	} while (FindNextFileA(find, &findData));
+
+	FindClose(find);
+
+	// 번호가 고정 폭이라 이름 순서가 곧 세그먼트 순서다
+	sort(paths.begin(), paths.end());
+	return paths;
+}
+
+bool ChatLog::ReadSegment(const string& path, const function<bool(const ChatLogRecord&)>& visit)
+{
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		cout << "[ChatLog] Open segment failed: " << path << ", " << GetLastError() << endl;
+		return false;
+	}
+
+	LARGE_INTEGER fileSize{};
+	GetFileSizeEx(file, &fileSize);
+	if (fileSize.QuadPart == 0)
+	{
+		CloseHandle(file);
+		return true;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	const char* view = (mapping != nullptr) ? static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+	if (view == nullptr)
+	{
+		cout << "[ChatLog] Map segment failed: " << path << ", " << GetLastError() << endl;
+		if (mapping != nullptr)
+			CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	size_t size = (size_t)fileSize.QuadPart;
+	size_t offset = 0;
+	bool intact = true;
+	while (offset + sizeof(ChatLogRecordHeader) <= size)
+	{
+		const auto* header = reinterpret_cast<const ChatLogRecordHeader*>(view + offset);
+		size_t bodySize = (size_t)header->senderLength + header->targetLength + header->messageLength;
+
+		// 쓰다 만 마지막 레코드
+		if (header->length != sizeof(ChatLogRecordHeader) + bodySize || offset + header->length > size)
+			break;
+
+		if (header->crc != ComputeRecordCrc(view + offset, header->length))
+		{
+			cout << "[ChatLog] CRC mismatch at offset " << offset << " (sequence " << header->sequence
+				<< "): " << path << ", stop reading" << endl;
+			intact = false;
+			break;
+		}
+
+		const char* body = view + offset + sizeof(ChatLogRecordHeader);
+
+		ChatLogRecord record;
+		record.header = header;
+		record.sender = string_view(body, header->senderLength);
+		record.target = string_view(body + header->senderLength, header->targetLength);
+		record.message = string_view(body + header->senderLength + header->targetLength, header->messageLength);
+
+		if (!visit(record))
+			break;
+
+		offset += header->length;
+	}
+
+	UnmapViewOfFile(view);
+	CloseHandle(mapping);
+	CloseHandle(file);
+	return intact;
+}
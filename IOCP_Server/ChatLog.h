@@ -0,0 +1,136 @@
+#pragma once
+#include <Windows.h>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <functional>
+#include <chrono>
+
+#define CHAT_LOG_SEGMENT_BYTES (64 * 1024 * 1024)		// 세그먼트 파일 하나의 최대 크기
+#define CHAT_LOG_SYNC_BYTES (1024 * 1024)				// 동기화 전에 쌓아 둘 최대 바이트 (넘으면 바로 쓴다)
+#define CHAT_LOG_SYNC_INTERVAL_MS 20					// 덜 쌓여도 이 시간이 지나면 디스크에 내린다
+#define CHAT_LOG_QUEUE_LIMIT_BYTES (64 * 1024 * 1024)	// 기록 스레드가 밀리면 넘는 메시지는 버리고 센다
+#define CHAT_LOG_OPEN_RETRIES 3							// 세그먼트를 바꿀 때 새 파일 열기를 다시 해 보는 횟수
+#define CHAT_LOG_OPEN_RETRY_MS 50
+#define CHAT_LOG_REOPEN_INTERVAL_MS 1000				// 그래도 못 열었으면 이 간격으로 다시 열어 본다 (그 사이 레코드는 버린다)
+
+using namespace std;
+
+enum class ChatLogType : uint8_t
+{
+	LOBBY,
+	WHISPER,
+	ROOM,
+};
+
+#pragma pack(push, 1)
+
+// 세그먼트 파일은 이 헤더 + sender + target + message 레코드를 이어 붙인 것이다
+struct ChatLogRecordHeader
+{
+	uint32_t length;		// 헤더를 포함한 레코드 전체 길이
+	uint32_t crc;			// 이 필드를 0으로 둔 헤더 + 본문의 CRC32
+	uint64_t sequence;		// 기록 스레드가 파일에 쓰는 순서대로 붙인다. 빈 번호는 쓰다 버린 레코드다
+	int64_t timestampMs;	// UTC 밀리초
+	uint32_t roomId;		// ROOM이 아니면 0
+	ChatLogType type;
+	uint8_t senderLength;	// 보낸 사람 loginId
+	uint8_t targetLength;	// WHISPER 받는 사람 닉네임
+	uint16_t messageLength;
+};
+
+#pragma pack(pop)
+
+// 매핑된 세그먼트를 가리키는 뷰. 방문 콜백 안에서만 유효하다
+struct ChatLogRecord
+{
+	const ChatLogRecordHeader* header;
+	string_view sender;
+	string_view target;
+	string_view message;
+};
+
+struct ChatLogStats
+{
+	uint64_t appended = 0;		// 큐에 들어간 레코드
+	uint64_t dropped = 0;		// 큐 한도를 넘어 버린 레코드
+	uint64_t written = 0;		// WriteFile까지 끝난 레코드
+	uint64_t synced = 0;		// FlushFileBuffers까지 끝난 레코드
+	uint64_t syncCount = 0;
+	uint64_t bytesWritten = 0;
+	uint32_t segmentIndex = 0;
+};
+
+// 채팅 감사 로그. 워커는 레코드를 락 없는 SLIST에 넣기만 하고,
+// 기록 스레드가 모아서 현재 세그먼트 끝에 쓴 뒤 크기나 시간 기준으로 한 번에 동기화한다.
+// 세그먼트는 chat_<번호>.log로 나뉘며 읽을 때는 파일을 매핑해 복사 없이 훑는다.
+class ChatLog
+{
+public:
+	ChatLog();
+	~ChatLog();
+
+	ChatLog(const ChatLog&) = delete;
+	ChatLog& operator=(const ChatLog&) = delete;
+
+	// 디렉터리의 마지막 세그먼트 다음 번호로 새 세그먼트를 열고 기록 스레드를 띄운다
+	bool Open(const string& directory);
+	// 남은 레코드를 모두 쓰고 동기화한 뒤 멈춘다. Append를 부르는 스레드가 모두 멈춘 뒤 호출
+	void Close();
+
+	// 워커에서 부른다. 한도를 넘었거나 닫혀 있으면 false
+	bool Append(ChatLogType type, string_view sender, string_view target, uint32_t roomId, string_view message);
+
+	ChatLogStats GetStats() const;
+
+	// 디렉터리의 세그먼트 경로를 번호 순서로
+	static vector<string> ListSegments(const string& directory);
+	// 세그먼트를 매핑해 레코드마다 visit을 부른다. visit이 false를 주면 멈춘다. 끝의 잘린 레코드는 건너뛴다.
+	// CRC가 맞지 않는 레코드를 만나면 그 뒤는 믿을 수 없으므로 거기서 멈추고 false
+	static bool ReadSegment(const string& path, const function<bool(const ChatLogRecord&)>& visit);
+
+private:
+	// SLIST 노드 뒤에 레코드 바이트가 이어진다
+	struct Entry
+	{
+		SLIST_ENTRY link;
+		uint32_t size;
+	};
+
+	void WriterLoop();
+	// 순서 번호와 CRC를 채운다
+	void SealRecord(char* record, uint32_t size);
+	bool OpenSegment(uint32_t index);
+	// 세그먼트를 바꿀 때. 잠깐 쉬었다 몇 번 더 열어 본다
+	bool OpenSegmentWithRetry(uint32_t index);
+	void WriteBuffer(vector<char>& buffer, uint64_t records);
+	void Sync();
+	void FreeQueue();
+
+private:
+	SLIST_HEADER mQueue;
+	atomic<int64_t> mPendingBytes;		// 큐에 있는 레코드 바이트
+	HANDLE mWakeEvent;
+	atomic<bool> mStopping;
+	thread mWriterThread;
+
+	// 기록 스레드만 접근
+	string mDirectory;
+	HANDLE mFile;
+	uint64_t mSegmentBytes;
+	uint64_t mUnsyncedRecords;
+	uint64_t mUnsyncedBytes;
+	uint64_t mSequence;
+	uint64_t mDroppedWhileClosed;		// 세그먼트를 못 연 동안 버린 레코드 (다시 열리면 로그로 남긴다)
+	chrono::steady_clock::time_point mReopenAt;
+
+	atomic<uint64_t> mAppended;
+	atomic<uint64_t> mDropped;
+	atomic<uint64_t> mWritten;
+	atomic<uint64_t> mSynced;
+	atomic<uint64_t> mSyncCount;
+	atomic<uint64_t> mBytesWritten;
+	atomic<uint32_t> mSegmentIndex;
+};
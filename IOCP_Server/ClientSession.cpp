@@ -1,80 +1,121 @@
 #include "ClientSession.h"
+#include "WorkerMailbox.h"
 #include "SRWLockGuard.h"
 #include <iostream>
 
-ClientSession::ClientSession(uint32_t poolIndex)
-	: mSessionId(0)
+ClientSession::ClientSession(uint32_t poolIndex, SessionHotState* hotState, WorkerMailbox* mailbox)
+	: mHot(hotState)
+	, mMailbox(mailbox)
+	, mSessionId(0)
 	, mPoolIndex(poolIndex)
-	, mRoomId(INVALID_ROOM_ID)
-	, mSocket(INVALID_SOCKET)
-	, mState(SessionState::IDLE)
-	, mRecvBuffer(MAX_SOCKBUF * 2)
+	, mLoginId(NameTable::Empty())
+	, mNickname(NameTable::Empty())
+	, mRoomSlot(INVALID_ROOM_SLOT)
+	, mDbRequestPending(false)
+	, mPinCount(0)
 	, mIsSending(false)
+	, mSendOffset(0)
+	, mSendingBytes(0)
+	, mSendBuf(nullptr)
+	, mFlushPending(false)
+	, mRecvBuffer(GetRecvBufferPool())
+	, mIoRefCount(0)
 {
 	ZeroMemory(&mRecvOverlappedEx, sizeof(OverlappedEx));
 	ZeroMemory(&mSendOverlappedEx, sizeof(OverlappedEx));
-	ZeroMemory(mTempRecvBuf, sizeof(mTempRecvBuf));
-	ZeroMemory(mSendBuf, sizeof(mSendBuf));
+	ZeroMemory(mRecvWsaBufs, sizeof(mRecvWsaBufs));
 
 	InitializeSRWLock(&mSendLock);
 }
 
+BufferPool& ClientSession::GetRecvBufferPool()
+{
+	static BufferPool pool(MAX_SOCKBUF * 2, 64);
+	return pool;
+}
+
+BufferPool& ClientSession::GetSendBufferPool()
+{
+	static BufferPool pool(MAX_SOCKBUF, 64);
+	return pool;
+}
+
 void ClientSession::Initialize(SOCKET socket, uint32_t sessionId)
 {
-	mSocket = socket;
 	mSessionId = sessionId;
-	mState = SessionState::CONNECTED;
-	mUserState = UserState::LOBBY;
+	mRoomSlot = (static_cast<uint64_t>(sessionId) << 32) | INVALID_ROOM_SLOT;
+	mHot->socket = socket;
+	mHot->state = SessionState::CONNECTED;
+	mHot->userState = UserState::LOBBY;
+	mHot->roomId = INVALID_ROOM_ID;
+	mDbRequestPending = false;
 	mIsSending = false;
-	mLoginId.clear();
-	mNickname.clear();
+	mLoginId = NameTable::Empty();
+	mNickname = NameTable::Empty();
 
-	while (!mSendQueue.empty())
-	{
-		mSendQueue.pop();
-	}
+	mSendQueue.clear();
+	mSendOffset = 0;
+	mSendingBytes = 0;
+	mIoRefCount = 1;
 
 	ZeroMemory(&mRecvOverlappedEx, sizeof(OverlappedEx));
 	ZeroMemory(&mSendOverlappedEx, sizeof(OverlappedEx));
-	ZeroMemory(mTempRecvBuf, sizeof(mTempRecvBuf));
-	ZeroMemory(mSendBuf, sizeof(mSendBuf));
 }
 
-void ClientSession::Reset()
+bool ClientSession::Reset()
 {
-	mState = SessionState::IDLE;
-	mUserState = UserState::LOBBY;
+	mHot->state = SessionState::IDLE;
+	mHot->userState = UserState::LOBBY;
 
-	SRWLockGuard lock(&mSendLock);
-
-	if (mSocket != INVALID_SOCKET)
 	{
-		closesocket(mSocket);
-		mSocket = INVALID_SOCKET;
-	}		
+		SRWLockGuard lock(&mSendLock);
 
-	mSessionId = 0;
-	mRoomId = INVALID_ROOM_ID;
+		if (mHot->socket != INVALID_SOCKET)
+		{
+			closesocket(mHot->socket);
+			mHot->socket = INVALID_SOCKET;
+		}
 
-	mLoginId.clear();
-	mNickname.clear();
+		// mRoomSlot은 남겨 둔다. 뒤따라오는 LEAVE 작업이 이전 sessionId로 자리를 O(1)에 찾는다
+		mSessionId = 0;
+		mHot->roomId = INVALID_ROOM_ID;
 
-	while (!mSendQueue.empty())
-	{
-		mSendQueue.pop();
+		// 이름은 아직 패킷을 처리 중인 워커가 읽을 수 있으므로 여기서 지우지 않는다 (FreeSlot에서 해제)
+
+		// 전송 중인 버퍼는 WSASend 완료 통지가 ProcessSend에서 반납한다
+		mSendQueue.clear();
+		mSendOffset = 0;
 	}
 
-	mIsSending = false;
+	// 수신 링은 소유 워커가 아직 읽고 있을 수 있으니 마지막 완료 통지까지 미룬다
+	return DropIoRef();
+}
+
+bool ClientSession::ReleaseIoRef()
+{
+	return DropIoRef();
+}
+
+bool ClientSession::DropIoRef()
+{
+	if (--mIoRefCount != 0)
+		return false;
+
+	mRecvBuffer.Release();
+
+	SRWLockGuard lock(&mSendLock);
+	ReleaseSendBuffer();
+	return true;
 }
 
 bool ClientSession::TryDisconnect()
 {
 	SessionState expected = SessionState::CONNECTED;
-	if (mState.compare_exchange_strong(expected, SessionState::DISCONNECTING))
+	if (mHot->state.compare_exchange_strong(expected, SessionState::DISCONNECTING))
 		return true;
 
 	expected = SessionState::AUTHENTICATED;
-	if (mState.compare_exchange_strong(expected, SessionState::DISCONNECTING))
+	if (mHot->state.compare_exchange_strong(expected, SessionState::DISCONNECTING))
 		return true;
 
 	return false;
@@ -82,15 +123,24 @@ bool ClientSession::TryDisconnect()
 
 bool ClientSession::SendPacket(const char* data, int length)
 {
-	if (mSocket == INVALID_SOCKET)
+	if (!mHot->IsValid())
+	{
+		return false;
+	}
+
+	return SendPacket(MakeSendBuffer(data, length));
+}
+
+bool ClientSession::SendPacket(const SendBufferPtr& buffer)
+{
+	if (!mHot->IsValid())
 	{
 		return false;
 	}
 
 	SRWLockGuard lock(&mSendLock);
 
-	vector<char> packet(data, data + length);
-	mSendQueue.push(move(packet));
+	mSendQueue.push_back(buffer);
 
 	if (!mIsSending)
 	{
@@ -100,33 +150,86 @@ bool ClientSession::SendPacket(const char* data, int length)
 	return true;
 }
 
+void ClientSession::PostPacket(uint32_t sessionId, const SendBufferPtr& buffer)
+{
+	if (!mHot->IsValid())
+		return;
+
+	mMailbox->Post(this, sessionId, buffer);
+}
+
+bool ClientSession::EnqueueSend(const SendBufferPtr& buffer)
+{
+	{
+		SRWLockGuard lock(&mSendLock);
+		mSendQueue.push_back(buffer);
+	}
+
+	if (mFlushPending)
+		return false;
+
+	mFlushPending = true;
+	return true;
+}
+
+void ClientSession::FlushSend()
+{
+	mFlushPending = false;
+
+	SRWLockGuard lock(&mSendLock);
+
+	if (!mIsSending)
+	{
+		ProcessSend();
+	}
+}
+
 void ClientSession::ProcessSend()
 {
-	if (mSendQueue.empty())
+	if (mSendQueue.empty() || mHot->socket == INVALID_SOCKET)
 	{
+		mSendQueue.clear();
+		mSendOffset = 0;
+		mSendingBytes = 0;
 		mIsSending = false;
+		ReleaseSendBuffer();
 		return;
 	}
 
 	mIsSending = true;
 
-	const auto& packet = mSendQueue.front();
+	if (mSendBuf == nullptr)
+	{
+		mSendBuf = GetSendBufferPool().Acquire();
+	}
 
-	if (packet.size() > MAX_SOCKBUF) {
-		std::cout << "[ClientSession] Packet too large: " << packet.size() << std::endl;
-		mSendQueue.pop();
-		ProcessSend();
-		return;
+	// 큐에 쌓인 패킷을 블록 크기까지 이어 붙여 한 번의 WSASend로 보낸다
+	size_t filled = 0;
+	size_t offset = mSendOffset;
+
+	for (const auto& packet : mSendQueue)
+	{
+		size_t copyLen = min(packet->size() - offset, static_cast<size_t>(MAX_SOCKBUF) - filled);
+		memcpy(mSendBuf + filled, packet->data() + offset, copyLen);
+
+		filled += copyLen;
+		offset = 0;
+
+		if (filled == MAX_SOCKBUF)
+			break;
 	}
 
-	memcpy(mSendBuf, packet.data(), packet.size());
+	mSendingBytes = filled;
 
 	ZeroMemory(&mSendOverlappedEx.wsaOverlapped, sizeof(WSAOVERLAPPED));
 	mSendOverlappedEx.operation = IOOperation::SEND;
 	mSendOverlappedEx.wsaBuf.buf = mSendBuf;
-	mSendOverlappedEx.wsaBuf.len = static_cast<ULONG>(packet.size());
+	mSendOverlappedEx.wsaBuf.len = static_cast<ULONG>(filled);
 
-	int ret = WSASend(mSocket,
+	// 소켓이 열려 있는 동안은 접속 참조가 남아 있어 실패해도 0이 되지 않는다
+	mIoRefCount++;
+
+	int ret = WSASend(mHot->socket,
 		&mSendOverlappedEx.wsaBuf,
 		1,
 		nullptr,
@@ -137,9 +240,12 @@ void ClientSession::ProcessSend()
 	if (ret == SOCKET_ERROR && WSAGetLastError() != WSA_IO_PENDING)
 	{
 		cout << "[ClientSession] WSASend Error: " << WSAGetLastError() << endl;
+		mIoRefCount--;
+		mSendQueue.clear();
+		mSendOffset = 0;
+		mSendingBytes = 0;
 		mIsSending = false;
-		mSendQueue.pop();
-		ProcessSend();
+		ReleaseSendBuffer();
 	}
 }
 
@@ -147,21 +253,40 @@ void ClientSession::OnSendCompleted()
 {
 	SRWLockGuard lock(&mSendLock);
 
-	if (!mSendQueue.empty())
+	size_t remain = mSendingBytes;
+	mSendingBytes = 0;
+
+	while (remain > 0 && !mSendQueue.empty())
 	{
-		mSendQueue.pop();
+		size_t left = mSendQueue.front()->size() - mSendOffset;
+		if (remain < left)
+		{
+			mSendOffset += remain;
+			break;
+		}
+
+		remain -= left;
+		mSendOffset = 0;
+		mSendQueue.pop_front();
 	}
 
 	ProcessSend();
 }
 
+void ClientSession::ReleaseSendBuffer()
+{
+	GetSendBufferPool().Release(mSendBuf);
+	mSendBuf = nullptr;
+}
+
 bool ClientSession::RegisterRecv()
 {
-	if (mState != SessionState::CONNECTED &&
-		mState != SessionState::AUTHENTICATED)
+	SessionState state = mHot->state;
+	if (state != SessionState::CONNECTED &&
+		state != SessionState::AUTHENTICATED)
 		return false;
 
-	if (mSocket == INVALID_SOCKET)
+	if (!mHot->IsValid())
 	{
 		return false;
 	}
@@ -175,12 +300,15 @@ bool ClientSession::RegisterRecv()
 	DWORD recvBytes = 0;
 	DWORD flag = 0;
 
+	// 버퍼 없이 0바이트로 걸어두고, 데이터가 도착하면 RecvData()에서 링버퍼를 빌린다
 	ZeroMemory(&mRecvOverlappedEx.wsaOverlapped, sizeof(WSAOVERLAPPED));
-	mRecvOverlappedEx.operation = IOOperation::RECV;
-	mRecvOverlappedEx.wsaBuf.buf = mTempRecvBuf; 
-	mRecvOverlappedEx.wsaBuf.len = MAX_SOCKBUF; 
+	mRecvOverlappedEx.operation = IOOperation::RECV_ZERO;
+	mRecvOverlappedEx.wsaBuf.buf = nullptr;
+	mRecvOverlappedEx.wsaBuf.len = 0;
+
+	mIoRefCount++;
 
-	int ret = WSARecv(mSocket,
+	int ret = WSARecv(mHot->socket,
 		&mRecvOverlappedEx.wsaBuf,
 		1,
 		&recvBytes,
@@ -191,16 +319,105 @@ bool ClientSession::RegisterRecv()
 	if (ret == SOCKET_ERROR && WSAGetLastError() != WSA_IO_PENDING)
 	{
 		cout << "[ClientSession] WSARecv Error: " << WSAGetLastError() << endl;
+		mIoRefCount--;
 		return false;
 	}
 
 	return true;
 }
 
+bool ClientSession::RecvData()
+{
+	if (!mHot->IsValid())
+	{
+		return false;
+	}
+
+	char* first = nullptr;
+	char* second = nullptr;
+	size_t firstLen = 0;
+	size_t secondLen = 0;
+
+	if (!mRecvBuffer.GetWritableSpans(first, firstLen, second, secondLen))
+	{
+		cout << "[ClientSession] Buffer overflow detected!" << endl;
+		return false;
+	}
+
+	mRecvWsaBufs[0].buf = first;
+	mRecvWsaBufs[0].len = static_cast<ULONG>(firstLen);
+	mRecvWsaBufs[1].buf = second;
+	mRecvWsaBufs[1].len = static_cast<ULONG>(secondLen);
+
+	DWORD recvBytes = 0;
+	DWORD flag = 0;
+
+	ZeroMemory(&mRecvOverlappedEx.wsaOverlapped, sizeof(WSAOVERLAPPED));
+	mRecvOverlappedEx.operation = IOOperation::RECV;
+
+	mIoRefCount++;
+
+	int ret = WSARecv(mHot->socket,
+		mRecvWsaBufs,
+		secondLen > 0 ? 2 : 1,
+		&recvBytes,
+		&flag,
+		(LPWSAOVERLAPPED)&mRecvOverlappedEx,
+		NULL);
+
+	if (ret == SOCKET_ERROR && WSAGetLastError() != WSA_IO_PENDING)
+	{
+		cout << "[ClientSession] WSARecv Error: " << WSAGetLastError() << endl;
+		mIoRefCount--;
+		return false;
+	}
+
+	return true;
+}
+
+bool ClientSession::OnRecvCompleted(DWORD transferred)
+{
+	// 수신 중에 Reset된 세션 - 링 반납은 ReleaseIoRef가 맡는다
+	if (!mHot->IsValid())
+		return false;
+
+	mRecvBuffer.CommitWrite(transferred);
+	return true;
+}
+
+void ClientSession::ReleaseIdleRecvBuffer()
+{
+	if (mRecvBuffer.IsEmpty())
+	{
+		mRecvBuffer.Release();
+	}
+}
+
+uint32_t ClientSession::GetRoomSlot(uint32_t sessionId) const
+{
+	uint64_t value = mRoomSlot;
+	if (static_cast<uint32_t>(value >> 32) != sessionId)
+		return INVALID_ROOM_SLOT;
+
+	return static_cast<uint32_t>(value);
+}
+
+void ClientSession::SetRoomSlot(uint32_t sessionId, uint32_t slot)
+{
+	uint64_t desired = (static_cast<uint64_t>(sessionId) << 32) | slot;
+	uint64_t current = mRoomSlot;
+
+	while (static_cast<uint32_t>(current >> 32) == sessionId)
+	{
+		if (mRoomSlot.compare_exchange_weak(current, desired))
+			return;
+	}
+}
+
 UserInfo ClientSession::ToUserInfo() const
 {
 	UserInfo info;
 	info.userId = mSessionId;
-	strncpy_s(info.nickname, sizeof(info.nickname), mNickname.c_str(), _TRUNCATE);
+	memcpy(info.nickname, GetUsernameBlob(), sizeof(info.nickname));
 	return info;
-}
\ No newline at end of file
+}
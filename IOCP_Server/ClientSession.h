@@ -1,14 +1,20 @@
 #pragma once
 #include <WinSock2.h>
 #include <string>
-#include <queue>
+#include <deque>
 #include <vector>
 #include <chrono>
 #include <atomic>
+#include <memory>
 #include "RingBuffer.h"
+#include "BufferPool.h"
+#include "NameTable.h"
 #include "../Common/Common.h"
 
 #define MAX_SOCKBUF 4096
+#define CACHE_LINE_SIZE 64
+
+constexpr uint32_t INVALID_ROOM_SLOT = UINT32_MAX;
 
 using namespace std;
 
@@ -28,8 +34,11 @@ enum class UserState
 
 enum class IOOperation
 {
+	RECV_ZERO,	// 0바이트 수신 대기 (버퍼 없이 데이터 도착만 통지받음)
 	RECV,
-	SEND
+	SEND,
+	FLUSH_MAILBOX,
+	ROOM_EXECUTE	// 방 작업 큐의 남은 작업을 이어서 처리
 };
 
 struct OverlappedEx
@@ -39,11 +48,36 @@ struct OverlappedEx
 	IOOperation operation;
 };
 
+// 팬아웃 시 검사하는 필드만 모아 풀 슬롯별로 한 캐시 라인에 둔다.
+// SessionManager가 슬롯 인덱스 순서의 연속 배열로 소유한다.
+struct alignas(CACHE_LINE_SIZE) SessionHotState
+{
+	SOCKET socket = INVALID_SOCKET;
+	atomic<SessionState> state{ SessionState::IDLE };
+	atomic<UserState> userState{ UserState::LOBBY };
+	atomic<uint32_t> roomId{ INVALID_ROOM_ID };
+
+	bool IsValid() const { return socket != INVALID_SOCKET; }
+	bool IsInLobby() const { return IsValid() && userState == UserState::LOBBY; }
+};
+
+static_assert(sizeof(SessionHotState) == CACHE_LINE_SIZE, "SessionHotState must fit in one cache line");
+
+// 여러 수신자가 같은 패킷 바이트를 공유하도록 참조 카운트로 들고 다닌다
+using SendBufferPtr = shared_ptr<vector<char>>;
+
+inline SendBufferPtr MakeSendBuffer(const char* data, int length)
+{
+	return make_shared<vector<char>>(data, data + length);
+}
+
+class WorkerMailbox;
+
 
 class ClientSession
 {
 public:
-	explicit ClientSession(uint32_t poolIndex);
+	ClientSession(uint32_t poolIndex, SessionHotState* hotState, WorkerMailbox* mailbox);
 	~ClientSession() = default;
 
 	ClientSession(const ClientSession&) = delete;
@@ -52,65 +86,139 @@ public:
 	ClientSession& operator=(ClientSession&&) = delete;
 
 	void Initialize(SOCKET socket, uint32_t sessionId);
-	void Reset();
+	// 소켓을 닫고 접속 참조를 내려놓는다. 걸린 I/O가 없어 바로 슬롯을 돌려줘도 되면 true
+	bool Reset();
+	// I/O 완료 통지를 다 처리한 워커가 부른다. Reset 뒤 마지막 완료였으면 버퍼를 반납하고 true
+	bool ReleaseIoRef();
 
 	bool SendPacket(const char* data, int length);
+	bool SendPacket(const SendBufferPtr& buffer);
+	// 세션이 sessionId 그대로일 때만 보낸다. id는 세션을 찾은 시점에 읽어 둔 값을 넘긴다
+	void PostPacket(uint32_t sessionId, const SendBufferPtr& buffer);
 	bool RegisterRecv();
+	bool RecvData();
+	bool OnRecvCompleted(DWORD transferred);
+	void ReleaseIdleRecvBuffer();
 	void OnSendCompleted();
 
+	// WorkerMailbox 소비자 전용
+	bool EnqueueSend(const SendBufferPtr& buffer);
+	void FlushSend();
+
 	bool TryDisconnect();
 
 	// Getter
 	uint32_t GetSessionId() const { return mSessionId; }
 	uint32_t GetPoolIndex() const { return mPoolIndex; }
-	SOCKET GetSocket() const { return mSocket; }
-	SessionState GetState() const { return mState; }	
-	const string& GetUsername() const { return mNickname; }
-	UserState GetUserState() const { return mUserState; }
-	const string& GetLoginId() const { return mLoginId; }
-	uint16_t GetRoomId() const { return mRoomId; }
-
-	char* GetTempRecvBuf() { return mTempRecvBuf; }
+	SOCKET GetSocket() const { return mHot->socket; }
+	SessionState GetState() const { return mHot->state; }
+	// 이름은 I/O 참조를 가진 쪽(완료 통지를 처리 중인 워커)에서만 읽는다. 엔트리는 슬롯을 돌려줄 때 해제된다.
+	// 고정(SessionRef)만 가진 방 작업 등은 큐에 넣을 때 복사해 둔 이름을 쓴다
+	string_view GetUsername() const { return mNickname.load()->View(); }
+	const char* GetUsernameBlob() const { return mNickname.load()->blob; }
+	UserState GetUserState() const { return mHot->userState; }
+	string_view GetLoginId() const { return mLoginId.load()->View(); }
+	const NameEntry* GetUsernameEntry() const { return mNickname; }
+	const NameEntry* GetLoginIdEntry() const { return mLoginId; }
+	uint32_t GetRoomId() const { return mHot->roomId; }
+	// sessionId가 다르면(재사용된 세션) INVALID_ROOM_SLOT
+	uint32_t GetRoomSlot(uint32_t sessionId) const;
+	WorkerMailbox* GetMailbox() const { return mMailbox; }
+
 	RingBuffer& GetRecvBuffer() { return mRecvBuffer; }
 
+	static BufferPool& GetRecvBufferPool();
+	static BufferPool& GetSendBufferPool();
+
 	// Setter
 	void SetSessionId(uint32_t id) { mSessionId = id; }
-	void SetState(SessionState state) { mState = state; }
-	void SetUserState(UserState userState) { mUserState = userState; }
-	void SetUsername(const string& name) { mNickname = name; }
-	void SetLoginId(const string& id) { mLoginId = id; }
-	void SetRoomId(uint16_t roomId) { mRoomId = roomId; }
-
-	bool IsValid() const { return mSocket != INVALID_SOCKET; }
-	bool IsAuthenticated() const { return mState == SessionState::AUTHENTICATED; }
+	void SetState(SessionState state) { mHot->state = state; }
+	bool TrySetState(SessionState expected, SessionState desired) { return mHot->state.compare_exchange_strong(expected, desired); }
+	void SetUserState(UserState userState) { mHot->userState = userState; }
+	bool TrySetUserState(UserState expected, UserState desired) { return mHot->userState.compare_exchange_strong(expected, desired); }
+	void SetUsername(const NameEntry* name) { mNickname = name; }
+	void SetLoginId(const NameEntry* id) { mLoginId = id; }
+	// 슬롯을 풀에 돌려줄 때 SessionManager가 부른다. 빈 이름으로 바꾸고 해제할 엔트리를 돌려준다
+	const NameEntry* TakeUsername() { return mNickname.exchange(NameTable::Empty()); }
+	const NameEntry* TakeLoginId() { return mLoginId.exchange(NameTable::Empty()); }
+	void SetRoomId(uint32_t roomId) { mHot->roomId = roomId; }
+	// 세션이 아직 sessionId일 때만 쓴다. 이전 방의 늦은 쓰기가 재사용된 세션에 섞이지 않는다
+	void SetRoomSlot(uint32_t sessionId, uint32_t slot);
+
+	// DB 요청은 세션당 하나만. 완료 작업이 EndDbRequest로 푼다
+	bool TryBeginDbRequest() { bool expected = false; return mDbRequestPending.compare_exchange_strong(expected, true); }
+	void EndDbRequest() { mDbRequestPending = false; }
+
+	bool IsValid() const { return mHot->IsValid(); }
+	bool IsAuthenticated() const { return mHot->state == SessionState::AUTHENTICATED; }
+
+	// SessionRef 전용. 고정된 세션이 있는 청크는 SessionManager가 해제하지 않는다
+	void Pin() { mPinCount++; }
+	void Unpin() { mPinCount--; }
+	bool IsPinned() const { return mPinCount != 0; }
 
 	UserInfo ToUserInfo() const;
 
 private:
 	void ProcessSend();
+	void ReleaseSendBuffer();
+	bool DropIoRef();
 
 private:
 
-	// Session 
-	uint32_t mSessionId;
+	// Session (Hot 필드는 SessionManager의 SessionHotState 배열에 있다)
+	SessionHotState* const mHot;
+	WorkerMailbox* const mMailbox;
+	atomic<uint32_t> mSessionId;	// 우편함/방 작업이 다른 스레드에서 읽고 Reset이 0으로 바꾼다
 	const uint32_t mPoolIndex;
-	string mLoginId;
-	SOCKET mSocket;
-	string mNickname;
-	atomic<SessionState> mState;
-	atomic<UserState> mUserState;
-	uint16_t mRoomId = 0;
-
-	// Recv
+	atomic<const NameEntry*> mLoginId;		// NameTable 소유. 마지막 I/O 참조가 빠져 슬롯을 돌려줄 때 해제한다
+	atomic<const NameEntry*> mNickname;
+	atomic<uint64_t> mRoomSlot;		// 상위 32비트 sessionId + 하위 32비트 방 멤버 배열 위치. 방 실행 워커만 쓴다
+	atomic<bool> mDbRequestPending;	// 로그인/가입이 DB 실행기에 가 있는 동안 true
+	atomic<int32_t> mPinCount;		// 이 세션을 가리키는 SessionRef 수
+
+	// Send - 여러 워커가 동시에 쓰므로 별도 캐시 라인에 둔다
+	alignas(CACHE_LINE_SIZE) SRWLOCK mSendLock;
+	bool mIsSending;
+	deque<SendBufferPtr> mSendQueue;
+	size_t mSendOffset;		// 큐 맨 앞 패킷에서 이미 보낸 바이트 수
+	size_t mSendingBytes;	// 현재 WSASend 중인 바이트 수
+	char* mSendBuf;			// 전송 중일 때만 풀에서 빌린다
+	bool mFlushPending;		// 우편함 소비자만 접근
+
+	// Cold - I/O 전용
+	alignas(CACHE_LINE_SIZE) OverlappedEx mSendOverlappedEx;
 	OverlappedEx mRecvOverlappedEx;
+	WSABUF mRecvWsaBufs[2];
 	RingBuffer mRecvBuffer;
-	char mTempRecvBuf[MAX_SOCKBUF];
 
-	// Send
-	OverlappedEx mSendOverlappedEx;
-	char mSendBuf[MAX_SOCKBUF];
-	queue<vector<char>> mSendQueue;
-	bool mIsSending;
-	SRWLOCK mSendLock;
+	// 걸려 있는 WSARecv/WSASend 수 + 접속 중이면 1.
+	// Reset은 다른 워커의 완료 처리와 겹칠 수 있어 송수신 버퍼를 직접 반납하지 않고,
+	// 이 값이 0이 되는 쪽(Reset 또는 마지막 완료 통지)이 반납하고 슬롯을 돌려준다.
+	atomic<int32_t> mIoRefCount;
 };
 
+// 우편함 항목, 방 작업/멤버, 실행기 작업처럼 세션 포인터를 큐에 오래 들고 있을 때 쓴다.
+// 슬롯 재사용은 sessionId로 걸러야 하고, 이 참조는 청크 메모리가 해제되지 않게만 막는다.
+class SessionRef
+{
+public:
+	SessionRef() : mSession(nullptr) {}
+	SessionRef(ClientSession* session) : mSession(session) { if (mSession != nullptr) mSession->Pin(); }
+	SessionRef(const SessionRef& other) : SessionRef(other.mSession) {}
+	SessionRef(SessionRef&& other) noexcept : mSession(other.mSession) { other.mSession = nullptr; }
+	~SessionRef() { if (mSession != nullptr) mSession->Unpin(); }
+
+	SessionRef& operator=(SessionRef other) noexcept
+	{
+		std::swap(mSession, other.mSession);
+		return *this;
+	}
+
+	ClientSession* Get() const { return mSession; }
+	ClientSession* operator->() const { return mSession; }
+	operator ClientSession*() const { return mSession; }
+
+private:
+	ClientSession* mSession;
+};
@@ -0,0 +1,322 @@
+#include "DbConnectionPool.h"
+#include "SRWLockGuard.h"
+#include <iostream>
+#include <algorithm>
+
+PooledConnection::PooledConnection(DbConnectionPool* pool, DbConnection* conn)
+	: mPool(pool)
+	, mConn(conn)
+{
+}
+
+PooledConnection::PooledConnection(PooledConnection&& other) noexcept
+	: mPool(other.mPool)
+	, mConn(other.mConn)
+	, mBroken(other.mBroken)
+{
+	other.mPool = nullptr;
+	other.mConn = nullptr;
+}
+
+PooledConnection::~PooledConnection()
+{
+	if (mConn != nullptr)
+		mPool->Return(mConn, mBroken);
+}
+
+void PooledConnection::CheckAfterError()
+{
+	// 중복 키 같은 쿼리 오류와 연결 끊김을 구분한다 (오류가 난 경우에만)
+	try
+	{
+		mConn->session->sql("SELECT 1").execute();
+	}
+	catch (...)
+	{
+		mBroken = true;
+	}
+}
+
+DbConnectionPool::DbConnectionPool()
+	: mStopping(false)
+	, mHealthWakePending(false)
+	, mHealthyCount(0)
+	, mState(DbHealthState::DOWN)
+{
+	InitializeSRWLock(&mLock);
+	InitializeConditionVariable(&mCondition);
+	InitializeConditionVariable(&mStopCondition);
+}
+
+DbConnectionPool::~DbConnectionPool()
+{
+	Stop();
+}
+
+bool DbConnectionPool::Init(const DbConnectionInfo& info, uint32_t poolSize, DbPrepareFunc prepare)
+{
+	mInfo = info;
+	mPrepare = std::move(prepare);
+
+	for (uint32_t i = 0; i < max(poolSize, 1u); ++i)
+	{
+		mConnections.emplace_back(make_unique<DbConnection>());
+		DbConnection* conn = mConnections.back().get();
+
+		bool connected = Connect(*conn);
+
+		SRWLockGuard lock(&mLock);
+		(connected ? mIdle : mBroken).push_back(conn);
+	}
+
+	mHealthyCount = static_cast<uint32_t>(mIdle.size());
+	UpdateState();
+
+	cout << "[DbConnectionPool] " << mHealthyCount << " / " << mConnections.size() << " connections ready" << endl;
+	if (mHealthyCount == 0)
+		return false;
+
+	mHealthThread = thread([this]() { HealthLoop(); });
+	return true;
+}
+
+void DbConnectionPool::Stop()
+{
+	{
+		SRWLockGuard lock(&mLock);
+		mStopping = true;
+	}
+
+	WakeAllConditionVariable(&mStopCondition);
+
+	if (mHealthThread.joinable())
+		mHealthThread.join();
+}
+
+bool DbConnectionPool::Connect(DbConnection& conn)
+{
+	try
+	{
+		// 문장은 세션을 참조하므로 먼저 버린다
+		conn.statements.reset();
+		conn.session.reset();
+		conn.session = make_unique<mysqlx::Session>(mInfo.host, mInfo.port, mInfo.user, mInfo.password);
+		conn.session->sql("USE " + mInfo.schema).execute();
+
+		if (mPrepare)
+			mPrepare(conn);
+
+		conn.failureCount = 0;
+		conn.lastUsed = chrono::steady_clock::now();
+		return true;
+	}
+	catch (const mysqlx::Error& e)
+	{
+		cout << "[DbConnectionPool] Connect mysqlx::Error: " << e.what() << endl;
+	}
+	catch (const std::exception& e)
+	{
+		cout << "[DbConnectionPool] Connect std::exception: " << e.what() << endl;
+	}
+
+	conn.statements.reset();
+	conn.session.reset();
+	conn.failureCount++;
+	return false;
+}
+
+PooledConnection DbConnectionPool::Checkout(DWORD timeoutMs)
+{
+	// 끊긴 동안에는 기다려 봐야 소용없으니 바로 실패시킨다
+	if (mState == DbHealthState::DOWN)
+		return PooledConnection();
+
+	// 깨어났는데 다른 스레드가 먼저 가져가면 다시 기다리므로, 남은 시간은 처음 정한 마감 시각에서 계산한다
+	auto deadline = chrono::steady_clock::now() + chrono::milliseconds(timeoutMs);
+
+	DbConnection* conn = nullptr;
+	{
+		SRWLockGuard lock(&mLock);
+
+		while (mIdle.empty())
+		{
+			if (mState == DbHealthState::DOWN)
+				return PooledConnection();
+
+			auto now = chrono::steady_clock::now();
+			if (now >= deadline)
+				return PooledConnection();
+
+			DWORD remainingMs = static_cast<DWORD>(chrono::ceil<chrono::milliseconds>(deadline - now).count());
+			SleepConditionVariableSRW(&mCondition, &mLock, remainingMs, 0);
+		}
+
+		conn = mIdle.back();
+		mIdle.pop_back();
+	}
+
+	conn->useCount++;
+	return PooledConnection(this, conn);
+}
+
+void DbConnectionPool::Return(DbConnection* conn, bool broken)
+{
+	conn->lastUsed = chrono::steady_clock::now();
+
+	bool wakeHealth = false;
+	{
+		SRWLockGuard lock(&mLock);
+
+		if (broken)
+		{
+			mBroken.push_back(conn);
+			mHealthyCount--;
+
+			// 여러 연결이 한꺼번에 끊겨도 점검 스레드는 한 번만 깨운다. 다음 바퀴가 모두 재연결한다
+			wakeHealth = !mHealthWakePending;
+			mHealthWakePending = true;
+		}
+		else
+		{
+			mIdle.push_back(conn);
+		}
+	}
+
+	if (broken)
+	{
+		UpdateState();
+
+		// DOWN이 되면 기다리던 요청도 깨워 바로 실패하게 한다
+		if (mState == DbHealthState::DOWN)
+			WakeAllConditionVariable(&mCondition);
+
+		if (wakeHealth)
+			WakeConditionVariable(&mStopCondition);
+	}
+	else
+	{
+		WakeConditionVariable(&mCondition);
+	}
+}
+
+void DbConnectionPool::UpdateState()
+{
+	uint32_t healthy = mHealthyCount;
+
+	if (healthy == 0)
+		mState = DbHealthState::DOWN;
+	else if (healthy < mConnections.size())
+		mState = DbHealthState::DEGRADED;
+	else
+		mState = DbHealthState::UP;
+}
+
+void DbConnectionPool::HealthLoop()
+{
+	DWORD backoffMs = DB_RECONNECT_BACKOFF_MS;
+
+	while (true)
+	{
+		DWORD waitMs = (mState == DbHealthState::UP) ? DB_HEALTH_INTERVAL_MS : backoffMs;
+		{
+			SRWLockGuard lock(&mLock);
+			if (!mStopping && !mHealthWakePending)
+				SleepConditionVariableSRW(&mStopCondition, &mLock, waitMs, 0);
+
+			if (mStopping)
+				return;
+
+			// 이번 바퀴 이후에 끊긴 연결이 다시 깨운다
+			mHealthWakePending = false;
+		}
+
+		DbHealthState before = mState;
+
+		ReconnectBroken();
+		PingIdle();
+		UpdateState();
+
+		// 재연결이 계속 실패하면 대기 시간을 두 배씩 늘린다
+		if (mState == DbHealthState::UP)
+			backoffMs = DB_RECONNECT_BACKOFF_MS;
+		else
+			backoffMs = min(backoffMs * 2, static_cast<DWORD>(DB_RECONNECT_BACKOFF_MAX_MS));
+
+		if (before != mState)
+		{
+			cout << "[DbConnectionPool] state " << static_cast<int>(before) << " -> " << static_cast<int>(mState.load())
+				<< " (" << mHealthyCount << " / " << mConnections.size() << " healthy)" << endl;
+		}
+	}
+}
+
+void DbConnectionPool::ReconnectBroken()
+{
+	vector<DbConnection*> broken;
+	{
+		SRWLockGuard lock(&mLock);
+		broken.swap(mBroken);
+	}
+
+	vector<DbConnection*> restored;
+	for (DbConnection* conn : broken)
+	{
+		if (Connect(*conn))
+			restored.push_back(conn);
+	}
+
+	{
+		SRWLockGuard lock(&mLock);
+
+		for (DbConnection* conn : broken)
+		{
+			if (find(restored.begin(), restored.end(), conn) == restored.end())
+				mBroken.push_back(conn);
+		}
+
+		mIdle.insert(mIdle.end(), restored.begin(), restored.end());
+		mHealthyCount += static_cast<uint32_t>(restored.size());
+	}
+
+	if (!restored.empty())
+		WakeAllConditionVariable(&mCondition);
+}
+
+void DbConnectionPool::PingIdle()
+{
+	// 요청이 계속 쓰는 연결은 그 자체로 살아 있음이 확인되므로 오래 쉰 연결만 점검한다
+	auto threshold = chrono::steady_clock::now() - chrono::milliseconds(DB_HEALTH_INTERVAL_MS);
+
+	vector<DbConnection*> stale;
+	{
+		SRWLockGuard lock(&mLock);
+
+		for (auto it = mIdle.begin(); it != mIdle.end(); )
+		{
+			if ((*it)->lastUsed < threshold)
+			{
+				stale.push_back(*it);
+				it = mIdle.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
+	}
+
+	for (DbConnection* conn : stale)
+	{
+		bool alive = true;
+		try
+		{
+			conn->session->sql("SELECT 1").execute();
+		}
+		catch (...)
+		{
+			alive = false;
+		}
+
+		Return(conn, !alive);
+	}
+}
@@ -0,0 +1,128 @@
+#pragma once
+#include <Windows.h>
+#include <mysqlx/xdevapi.h>
+#include <vector>
+#include <memory>
+#include <string>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <functional>
+
+#define DB_POOL_SIZE 8
+#define DB_CHECKOUT_TIMEOUT_MS 3000
+#define DB_HEALTH_INTERVAL_MS 5000		// 쉬고 있는 연결을 점검하는 주기
+#define DB_RECONNECT_BACKOFF_MS 500		// 재연결 대기 시작값 (실패할 때마다 두 배)
+#define DB_RECONNECT_BACKOFF_MAX_MS 30000
+
+using namespace std;
+
+enum class DbHealthState
+{
+	UP,			// 모든 연결 정상
+	DEGRADED,	// 일부 연결이 끊겨 점검 스레드가 재연결 중
+	DOWN		// 쓸 수 있는 연결이 없다. 요청은 기다리지 않고 바로 실패한다
+};
+
+struct DbConnectionInfo
+{
+	string host;
+	int port = 0;
+	string user;
+	string password;
+	string schema;
+};
+
+// 연결마다 재사용할 문장 묶음. 내용은 DbManager가 정한다
+struct DbStatements;
+
+struct DbConnection
+{
+	unique_ptr<mysqlx::Session> session;
+	shared_ptr<DbStatements> statements;	// (재)연결 직후 DbPrepareFunc가 채운다
+	uint32_t failureCount = 0;		// 연속으로 연결에 실패한 횟수
+	uint64_t useCount = 0;
+	chrono::steady_clock::time_point lastUsed;
+};
+
+// 연결이 새로 열릴 때마다 호출된다
+using DbPrepareFunc = function<void(DbConnection&)>;
+
+class DbConnectionPool;
+
+// 풀에서 빌린 연결. 소멸 시 풀에 돌려준다.
+// 쿼리가 예외를 던지면 CheckAfterError로 연결 자체가 죽었는지 확인해 표시한다.
+class PooledConnection
+{
+public:
+	PooledConnection() = default;
+	PooledConnection(DbConnectionPool* pool, DbConnection* conn);
+	~PooledConnection();
+
+	PooledConnection(PooledConnection&& other) noexcept;
+	PooledConnection& operator=(PooledConnection&&) = delete;
+	PooledConnection(const PooledConnection&) = delete;
+	PooledConnection& operator=(const PooledConnection&) = delete;
+
+	explicit operator bool() const { return mConn != nullptr; }
+	mysqlx::Session* operator->() const { return mConn->session.get(); }
+	DbStatements& Statements() const { return *mConn->statements; }
+
+	void CheckAfterError();
+
+private:
+	DbConnectionPool* mPool = nullptr;
+	DbConnection* mConn = nullptr;
+	bool mBroken = false;
+};
+
+// 크기가 고정된 mysqlx::Session 풀. StartServer에서 전부 미리 연결해 둔다.
+// 연결마다 한 번에 한 스레드만 쓰므로 DB 실행기 스레드 수만큼 동시에 쿼리가 나간다.
+// 연결 점검과 재연결은 점검 스레드가 맡아서 요청 경로는 작업당 쿼리 하나만 보낸다.
+class DbConnectionPool
+{
+public:
+	DbConnectionPool();
+	~DbConnectionPool();
+
+	DbConnectionPool(const DbConnectionPool&) = delete;
+	DbConnectionPool& operator=(const DbConnectionPool&) = delete;
+
+	// poolSize개를 모두 연결해 보고 점검 스레드를 띄운다. 하나도 못 열면 false
+	bool Init(const DbConnectionInfo& info, uint32_t poolSize, DbPrepareFunc prepare = nullptr);
+	void Stop();
+
+	// 빈 연결이 생길 때까지 최대 timeoutMs 기다린다 (몇 번 깨어나도 합쳐서). DOWN이거나 시간이 지나면 빈 핸들
+	PooledConnection Checkout(DWORD timeoutMs = DB_CHECKOUT_TIMEOUT_MS);
+
+	DbHealthState GetState() const { return mState; }
+	uint32_t GetPoolSize() const { return static_cast<uint32_t>(mConnections.size()); }
+	uint32_t GetHealthyCount() const { return mHealthyCount; }
+
+private:
+	friend class PooledConnection;
+	void Return(DbConnection* conn, bool broken);
+	bool Connect(DbConnection& conn);
+
+	void HealthLoop();
+	void ReconnectBroken();
+	void PingIdle();
+	void UpdateState();
+
+private:
+	DbConnectionInfo mInfo;
+	DbPrepareFunc mPrepare;
+	vector<unique_ptr<DbConnection>> mConnections;
+
+	SRWLOCK mLock;
+	CONDITION_VARIABLE mCondition;		// 연결 반납
+	CONDITION_VARIABLE mStopCondition;	// 점검 스레드 깨우기
+	vector<DbConnection*> mIdle;		// mLock, 정상 연결만
+	vector<DbConnection*> mBroken;		// mLock, 점검 스레드가 재연결한다
+	bool mStopping;						// mLock
+	bool mHealthWakePending;			// mLock, 점검 스레드를 깨워 둔 뒤 아직 한 바퀴 돌지 않았다
+
+	atomic<uint32_t> mHealthyCount;
+	atomic<DbHealthState> mState;
+	thread mHealthThread;
+};
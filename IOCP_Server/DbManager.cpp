@@ -1,20 +1,51 @@
 #include "DbManager.h"
 
+#include "SRWLockGuard.h"
 #include <iostream>
+#include <chrono>
+#include <unordered_set>
 
 using namespace std;
 
+DbStatements::DbStatements(mysqlx::Session& session, const string& schema)
+    : users(session.getSchema(schema).getTable("users"))
+    , selectUserByLoginId(users.select("user_id", "login_id", "password_hash", "nickname")
+                               .where("login_id = :loginId")
+                               .limit(1))
+{
+}
+
+// login_id UNIQUE 제약 위반(ER_DUP_ENTRY 1062)을 예외 대신 영향 행 수로 받는다.
+// X DevAPI의 mysqlx::Error는 서버 오류 번호를 주지 않으므로 메시지 문자열에 기대지 않으려는 것이다.
+// 이미 있는 아이디면 아무것도 바꾸지 않아 영향 행 수가 0이 된다.
+static const char* INSERT_USER_SQL =
+    "INSERT INTO users (login_id, password_hash, nickname) VALUES (?, ?, ?) "
+    "ON DUPLICATE KEY UPDATE user_id = user_id";
+
+DbManager::DbManager()
+    : mRegisterStopping(false)
+{
+    InitializeSRWLock(&mRegisterLock);
+    InitializeConditionVariable(&mRegisterCondition);
+}
+
+DbManager::~DbManager()
+{
+    Stop();
+}
+
 bool DbManager::CreateTables()
 {
-    try
+    PooledConnection conn = mPool.Checkout();
+    if (!conn)
     {
-        if (!mSession)
-        {
-            cout << "[DB] CreateTables Error: session is null" << endl;
-            return false;
-        }
+        cout << "[DB] CreateTables Error: no connection" << endl;
+        return false;
+    }
 
-        mSession->sql(R"(
+    try
+    {
+        conn->sql(R"(
         CREATE TABLE IF NOT EXISTS users (
             user_id INT AUTO_INCREMENT PRIMARY KEY,
             login_id VARCHAR(32) NOT NULL UNIQUE,
@@ -29,27 +60,29 @@ bool DbManager::CreateTables()
     catch (const mysqlx::Error& e)
     {
         cout << "[DB] CreateTables Error: " << e.what() << endl;
+        conn.CheckAfterError();
         return false;
     }
-    return true;
 }
 
 bool DbManager::ClearTable()
 {
-    try
+    PooledConnection conn = mPool.Checkout();
+    if (!conn)
     {
-        if (!mSession)
-        {
-            cout << "[DB] ClearTable Error: session is null" << endl;
-            return false;
-        }
+        cout << "[DB] ClearTable Error: no connection" << endl;
+        return false;
+    }
 
-        mSession->sql("DELETE FROM users").execute();
+    try
+    {
+        conn->sql("DELETE FROM users").execute();
         return true;
     }
     catch (const mysqlx::Error& e)
     {
         cout << "[DB] ClearTable Error: " << e.what() << endl;
+        conn.CheckAfterError();
         return false;
     }
 }
@@ -58,119 +91,293 @@ bool DbManager::Init(const string& host,
 					 int port,
 					 const string& user,
 					 const string& password,
-					 const string& schema)
+					 const string& schema,
+					 uint32_t poolSize)
 {
 	mSchema = schema;
 
-    try
+    // 서버 시작 시 모든 연결을 열어 두어 첫 로그인들이 연결 비용을 물지 않게 한다
+    DbConnectionInfo info{ host, port, user, password, schema };
+    bool ready = mPool.Init(info, poolSize, [this](DbConnection& conn)
     {
-        mSession = make_unique<mysqlx::Session>(host, port, user, password);
+        conn.statements = make_shared<DbStatements>(*conn.session, mSchema);
+    });
 
-        // 스키마 선택
-        mSession->sql("USE " + mSchema).execute();
+    if (ready)
+        mRegisterThread = thread([this]() { RegisterBatchLoop(); });
 
-        // 연결 테스트
-        mSession->sql("SELECT 1").execute();
+    return ready;
+}
 
-        return true;
+bool DbManager::IsConnected() const
+{
+    // 점검 스레드가 유지하는 상태만 본다. 요청 경로에서 따로 확인 쿼리를 보내지 않는다
+    return mPool.GetState() != DbHealthState::DOWN;
+}
+
+void DbManager::PrintStats()
+{
+    UserCacheStats stats = mUserCache.GetStats();
+    cout << "[Stats] user cache: " << stats.size << " entries, hit rate " << stats.GetHitRate() * 100.0
+        << "% (" << stats.hits << " hits / " << stats.misses << " misses), evicted " << stats.evictions
+        << ", expired " << stats.expirations << ", invalidated " << stats.invalidations
+        << ", stale fills " << stats.staleFills << endl;
+}
+
+DbResult DbManager::RegisterUser(const string& loginId,
+                                 const string& passwordHash,
+                                 const string& nickname)
+{
+    PooledConnection conn = mPool.Checkout();
+    if (!conn)
+        return DbResult::CONNECTION_ERROR;
+
+    return InsertUser(conn, loginId, passwordHash, nickname);
+}
+
+DbResult DbManager::InsertUser(PooledConnection& conn,
+                               const string& loginId,
+                               const string& passwordHash,
+                               const string& nickname)
+{
+    // 중복 확인은 UNIQUE 제약에 맡기고 INSERT 한 번만 보낸다. 중복은 오류가 아니므로 연결 점검도 하지 않는다
+    try
+    {
+        auto result = conn->sql(INSERT_USER_SQL)
+            .bind(loginId, passwordHash, nickname)
+            .execute();
+
+        if (result.getAffectedItemsCount() == 0)
+            return DbResult::DUPLICATE_ID;
+
+        mUserCache.Invalidate(loginId);
+        return DbResult::OK;
     }
     catch (const mysqlx::Error& e)
     {
-        std::cout << "[DB] Init mysqlx::Error: " << e.what() << std::endl;
+        cout << "[DB] InsertUser mysqlx::Error: " << e.what() << endl;
+        conn.CheckAfterError();
+        return DbResult::QUERY_ERROR;
     }
-    catch (const std::exception& e)
+    catch (...)
     {
-        std::cout << "[DB] Init std::exception: " << e.what() << std::endl;
+        cout << "[DB] InsertUser unknown error" << endl;
+        conn.CheckAfterError();
+        return DbResult::QUERY_ERROR;
     }
-
-    return false;
 }
 
-bool DbManager::IsConnected() const
+bool DbManager::EnqueueRegister(string loginId, string passwordHash, string nickname, RegisterCallback done)
 {
-    if (mSession == nullptr)
-        return false;
+    bool wake = false;
+    {
+        SRWLockGuard lock(&mRegisterLock);
 
-    try
+        if (mRegisterStopping || mPendingRegisters.size() >= REGISTER_QUEUE_LIMIT)
+            return false;
+
+        mPendingRegisters.push_back({ move(loginId), move(passwordHash), move(nickname), move(done) });
+
+        // 비어 있다가 처음 들어왔을 때와 한 배치가 가득 찼을 때만 깨운다
+        wake = mPendingRegisters.size() == 1 || mPendingRegisters.size() == REGISTER_BATCH_MAX_ROWS;
+    }
+
+    if (wake)
+        WakeConditionVariable(&mRegisterCondition);
+
+    return true;
+}
+
+void DbManager::Stop()
+{
     {
-        mSession->sql("SELECT 1").execute();
-        return true;
+        SRWLockGuard lock(&mRegisterLock);
+        mRegisterStopping = true;
     }
-    catch (...)
+
+    WakeConditionVariable(&mRegisterCondition);
+
+    if (mRegisterThread.joinable())
+        mRegisterThread.join();
+}
+
+void DbManager::RegisterBatchLoop()
+{
+    while (true)
     {
-        return false;
+        vector<PendingRegister> batch;
+        {
+            SRWLockGuard lock(&mRegisterLock);
+
+            while (mPendingRegisters.empty() && !mRegisterStopping)
+                SleepConditionVariableSRW(&mRegisterCondition, &mRegisterLock, INFINITE, 0);
+
+            if (mPendingRegisters.empty())
+                return;
+
+            // 첫 요청 뒤 창 시간만큼 더 모은다. 배치가 차면 바로 쓴다
+            auto deadline = chrono::steady_clock::now() + chrono::milliseconds(REGISTER_BATCH_WINDOW_MS);
+            while (!mRegisterStopping && mPendingRegisters.size() < REGISTER_BATCH_MAX_ROWS)
+            {
+                auto remaining = chrono::duration_cast<chrono::milliseconds>(deadline - chrono::steady_clock::now()).count();
+                if (remaining <= 0)
+                    break;
+
+                SleepConditionVariableSRW(&mRegisterCondition, &mRegisterLock, static_cast<DWORD>(remaining), 0);
+            }
+
+            size_t count = min(mPendingRegisters.size(), static_cast<size_t>(REGISTER_BATCH_MAX_ROWS));
+            batch.assign(make_move_iterator(mPendingRegisters.begin()), make_move_iterator(mPendingRegisters.begin() + count));
+            mPendingRegisters.erase(mPendingRegisters.begin(), mPendingRegisters.begin() + count);
+        }
+
+        FlushRegisterBatch(batch);
     }
 }
 
-DbResult DbManager::RegisterUser(const string& loginId,
-                                 const string& passwordHash,
-                                 const string& nickname)
+void DbManager::FlushRegisterBatch(vector<PendingRegister>& batch)
 {
-    if (!IsConnected())
-        return DbResult::CONNECTION_ERROR;
+    vector<DbResult> results(batch.size(), DbResult::OK);
+
+    // 같은 배치 안에서 겹치는 아이디는 먼저 온 것만 넣는다
+    vector<size_t> rows;
+    unordered_set<string> seen;
+    for (size_t i = 0; i < batch.size(); ++i)
+    {
+        if (seen.insert(batch[i].loginId).second)
+            rows.push_back(i);
+        else
+            results[i] = DbResult::DUPLICATE_ID;
+    }
+
+    PooledConnection conn = mPool.Checkout();
+    if (!conn)
+    {
+        for (size_t i : rows)
+            results[i] = DbResult::CONNECTION_ERROR;
+    }
+    else if (!rows.empty() && !FilterExistingLoginIds(conn, batch, rows, results))
+    {
+        for (size_t i : rows)
+            results[i] = DbResult::QUERY_ERROR;
+    }
+    else if (!rows.empty())
+    {
+        try
+        {
+            auto insert = conn.Statements().users.insert("login_id", "password_hash", "nickname");
+            for (size_t i : rows)
+                insert.values(batch[i].loginId, batch[i].passwordHash, batch[i].nickname);
+
+            insert.execute();
 
+            for (size_t i : rows)
+                mUserCache.Invalidate(batch[i].loginId);
+        }
+        catch (const mysqlx::Error& e)
+        {
+            // 조회와 INSERT 사이에 다른 경로로 같은 아이디가 들어온 경우다. 여러 행 INSERT는 전부 취소됐으므로
+            // 한 행씩 다시 넣어 영향 행 수로 가린다. 연결 문제면 첫 행에서 QUERY_ERROR가 나오므로 나머지는 보내지 않는다
+            cout << "[DB] FlushRegisterBatch mysqlx::Error: " << e.what() << ", retrying row by row" << endl;
+
+            bool failed = false;
+            for (size_t i : rows)
+            {
+                results[i] = failed ? DbResult::QUERY_ERROR
+                                    : InsertUser(conn, batch[i].loginId, batch[i].passwordHash, batch[i].nickname);
+                failed = results[i] == DbResult::QUERY_ERROR;
+            }
+        }
+        catch (...)
+        {
+            // 값을 만들다 메모리가 부족한 경우 등. 배치 스레드 밖으로 던지면 done이 불리지 않아 세션이 묶인다
+            cout << "[DB] FlushRegisterBatch unknown error" << endl;
+            conn.CheckAfterError();
+
+            for (size_t i : rows)
+                results[i] = DbResult::QUERY_ERROR;
+        }
+    }
+
+    for (size_t i = 0; i < batch.size(); ++i)
+        batch[i].done(results[i]);
+}
+
+bool DbManager::FilterExistingLoginIds(PooledConnection& conn, const vector<PendingRegister>& batch,
+                                       vector<size_t>& rows, vector<DbResult>& results)
+{
+    // 중복 하나 때문에 여러 행 INSERT 전체가 취소되지 않도록 이미 있는 아이디를 한 번에 골라낸다
     try
     {
-        auto res = mSession->sql("SELECT 1 FROM users WHERE login_id=? LIMIT 1").bind(loginId).execute();
+        string sql = "SELECT login_id FROM users WHERE login_id IN (";
+        for (size_t n = 0; n < rows.size(); ++n)
+            sql += (n == 0) ? "?" : ", ?";
+        sql += ")";
 
-        auto row = res.fetchOne();
-        if (row)
-            return DbResult::DUPLICATE_ID;
+        auto select = conn->sql(sql);
+        for (size_t i : rows)
+            select.bind(batch[i].loginId);
 
-        mSession->sql(
-            "INSERT INTO users(login_id, password_hash, nickname) VALUES(?,?,?)"
-        ).bind(loginId, passwordHash, nickname).execute();
+        unordered_set<string> existing;
+        for (auto row : select.execute().fetchAll())
+            existing.insert(string(row[0]));
 
-        return DbResult::OK;
+        if (existing.empty())
+            return true;
+
+        vector<size_t> remaining;
+        for (size_t i : rows)
+        {
+            if (existing.count(batch[i].loginId) != 0)
+                results[i] = DbResult::DUPLICATE_ID;
+            else
+                remaining.push_back(i);
+        }
+
+        rows.swap(remaining);
+        return true;
     }
     catch (const mysqlx::Error& e)
     {
-        cout << "[DB] RegisterUser mysqlx::Error: " << e.what() << endl;
-        return DbResult::QUERY_ERROR;
+        cout << "[DB] FilterExistingLoginIds mysqlx::Error: " << e.what() << endl;
+        conn.CheckAfterError();
+        return false;
     }
     catch (...)
     {
-        cout << "[DB] RegisterUser unknown error" << endl;
-        return DbResult::QUERY_ERROR;
+        cout << "[DB] FilterExistingLoginIds unknown error" << endl;
+        conn.CheckAfterError();
+        return false;
     }
 }
 
-DbResult DbManager::LoginUser(const string& loginId,
-                          const string& inputPasswordHash,
-                          UserRow& outUser)
+DbResult DbManager::FindUser(const string& loginId, UserRow& outUser)
 {
-    if (!IsConnected())
-        return DbResult::CONNECTION_ERROR;
+    if (mUserCache.Get(loginId, outUser))
+        return DbResult::OK;
 
-    UserRow user{};
-    DbResult result = GetUserByLoginId(loginId, user);
+    // 조회 도중 가입/변경이 무효화하면 이 결과는 캐시에 넣지 않는다
+    uint64_t generation = mUserCache.GetGeneration(loginId);
+
+    PooledConnection conn = mPool.Checkout();
+    if (!conn)
+        return DbResult::CONNECTION_ERROR;
 
-    if (result != DbResult::OK)
-        return result;
+    DbResult result = GetUserByLoginId(conn, loginId, outUser);
 
-    if (user.passwordHash != inputPasswordHash)
-        return DbResult::WRONG_PASSWORD;
+    if (result == DbResult::OK)
+        mUserCache.Put(outUser, generation);
 
-    outUser = move(user);
-    return DbResult::OK;
+    return result;
 }
 
-DbResult DbManager::GetUserByLoginId(const string& loginId,
+DbResult DbManager::GetUserByLoginId(PooledConnection& conn,
+                                     const string& loginId,
                                      UserRow& outUser)
 {
-    if (!IsConnected())
-        return DbResult::CONNECTION_ERROR;
-
-    lock_guard<mutex> lock(mDbMutex);
-
     try
     {
-        auto res = mSession->sql(R"(
-            SELECT user_id, login_id, password_hash, nickname
-            FROM users
-            WHERE login_id=? LIMIT 1
-        )"
-        ).bind(loginId).execute();
+        auto res = conn.Statements().selectUserByLoginId.bind("loginId", loginId).execute();
 
         auto row = res.fetchOne();
 
@@ -187,11 +394,13 @@ DbResult DbManager::GetUserByLoginId(const string& loginId,
     catch (const mysqlx::Error& e)
     {
         cout << "[DB] GetUserByLoginId mysqlx::Error: " << e.what() << endl;
+        conn.CheckAfterError();
         return DbResult::QUERY_ERROR;
     }
     catch (...)
     {
         cout << "[DB] GetUserByLoginId unknown error" << endl;
+        conn.CheckAfterError();
         return DbResult::QUERY_ERROR;
     }        
-}
\ No newline at end of file
+}
@@ -1,35 +1,34 @@
 #pragma once
 #include <mysqlx/xdevapi.h>
 #include <string>
-#include <mutex>
+#include <vector>
+#include <thread>
+#include "DbConnectionPool.h"
+#include "UserCache.h"
+#include "UserStore.h"
+
+#define REGISTER_BATCH_MAX_ROWS 256		// 여러 행 INSERT 한 번에 담는 최대 가입 수
+#define REGISTER_BATCH_WINDOW_MS 5		// 첫 요청 뒤 더 모으는 시간
+#define REGISTER_QUEUE_LIMIT 8192
 
 using namespace std;
 
-enum class DbResult
+// 연결마다 한 번 만들어 두고 값만 바꿔 다시 실행하는 문장들.
+// X DevAPI는 같은 문장이 두 번째 실행될 때 서버에 prepare 해 두고 이후엔 실행만 보낸다.
+struct DbStatements
 {
-	OK,
-
-	DUPLICATE_ID,
-	USER_NOT_FOUND,
-	WRONG_PASSWORD,
+	mysqlx::Table users;
+	mysqlx::TableSelect selectUserByLoginId;	// :loginId
 
-	CONNECTION_ERROR,
-	QUERY_ERROR
-};
-
-struct UserRow
-{
-	long long id = 0;
-	string loginId;
-	string passwordHash;
-	string nickname;
+	DbStatements(mysqlx::Session& session, const string& schema);
 };
 
-class DbManager
+// MySQL(X DevAPI) 계정 저장소
+class DbManager : public UserStore
 {
 public:
-	DbManager() = default;
-	~DbManager() = default;
+	DbManager();
+	~DbManager() override;
 
 	DbManager(const DbManager&) = delete;
 	DbManager& operator=(const DbManager&) = delete;
@@ -37,28 +36,60 @@ public:
 	bool CreateTables();
 	bool ClearTable();
 
+	// 연결 풀을 poolSize개로 미리 채운다
 	bool Init(const string& host,
 			  int port,
 			  const string& user,
 			  const string& password,
-			  const string& schema);
+			  const string& schema,
+			  uint32_t poolSize = DB_POOL_SIZE);
 	
-	bool IsConnected() const;
+	bool IsConnected() const override;
+	uint32_t GetPoolSize() const { return mPool.GetPoolSize(); }
 
 	DbResult RegisterUser(const string& loginId,
 						   const string& passwordHash,
-						   const string& nickname);
+						   const string& nickname) override;
 
-	DbResult LoginUser(const string& loginId,
-					const string& passwordHash,
-					UserRow& outUser);
+	// 가입을 모아 두었다가 여러 행 INSERT 한 번으로 쓴다. done은 배치 스레드에서 행별 결과로 불린다
+	bool EnqueueRegister(string loginId, string passwordHash, string nickname, RegisterCallback done) override;
+	// 남은 가입을 모두 쓰고 배치 스레드를 멈춘다
+	void Stop() override;
+
+	// 캐시에 있으면 DB를 거치지 않는다
+	DbResult FindUser(const string& loginId, UserRow& outUser) override;
+
+	void InvalidateUser(const string& loginId) override { mUserCache.Invalidate(loginId); }
+	UserCacheStats GetUserCacheStats() { return mUserCache.GetStats(); }
+	void PrintStats() override;
 
 private:
-	DbResult GetUserByLoginId(const string& loginId, UserRow& outUser);
+	DbResult GetUserByLoginId(PooledConnection& conn, const string& loginId, UserRow& outUser);
+	DbResult InsertUser(PooledConnection& conn, const string& loginId, const string& passwordHash, const string& nickname);
+
+	struct PendingRegister
+	{
+		string loginId;
+		string passwordHash;
+		string nickname;
+		RegisterCallback done;
+	};
+
+	void RegisterBatchLoop();
+	void FlushRegisterBatch(vector<PendingRegister>& batch);
+	// rows 중 이미 DB에 있는 아이디를 DUPLICATE_ID로 표시하고 rows에서 뺀다. 조회에 실패하면 false
+	bool FilterExistingLoginIds(PooledConnection& conn, const vector<PendingRegister>& batch,
+								vector<size_t>& rows, vector<DbResult>& results);
 	
 private:
-	unique_ptr<mysqlx::Session> mSession;
+	DbConnectionPool mPool;
 	string mSchema;
-	mutex mDbMutex;
+	UserCache mUserCache;
+
+	SRWLOCK mRegisterLock;
+	CONDITION_VARIABLE mRegisterCondition;
+	vector<PendingRegister> mPendingRegisters;	// mRegisterLock
+	bool mRegisterStopping;						// mRegisterLock
+	thread mRegisterThread;
 };
 
@@ -3,9 +3,14 @@
 IOCPServer::IOCPServer()
 	: mListenSocket(INVALID_SOCKET)
 	, mIOCPHandle(nullptr)
+	, mWorkerCount(MAX_WORKERTHREAD)
 	, mSessionManager(nullptr)
 	, mRoomManager(nullptr)
-	, mDbManager(nullptr)
+	, mUserStore(nullptr)
+	, mDbExecutor(nullptr)
+	, mCryptoExecutor(nullptr)
+	, mChatLog(nullptr)
+	, mAuthAdmission(nullptr)
 	, mSessionIdCounter(1)
 	, mIsAcceptRun(true)
 {
@@ -23,8 +28,20 @@ IOCPServer::~IOCPServer()
 	delete mPacketHandler;
 	mPacketHandler = nullptr;
 
-	delete mDbManager;
-	mDbManager = nullptr;
+	delete mDbExecutor;
+	mDbExecutor = nullptr;
+
+	delete mCryptoExecutor;
+	mCryptoExecutor = nullptr;
+
+	delete mChatLog;
+	mChatLog = nullptr;
+
+	delete mAuthAdmission;
+	mAuthAdmission = nullptr;
+
+	delete mUserStore;
+	mUserStore = nullptr;
 	
 	WSACleanup();
 }
@@ -73,49 +90,73 @@ bool IOCPServer::BindAndListen(int bindPort)
 	return true;
 }
 
-bool IOCPServer::StartServer(UINT32 maxClientCount)
+bool IOCPServer::StartServer(const ServerConfig& config)
 {
-	mSessionManager = new SessionManager(maxClientCount);
-	mRoomManager = new RoomManager(MAX_ROOM_COUNT);
-	mDbManager = new DbManager();
+	mWorkerCount = (config.workerCount == 0) ? MAX_WORKERTHREAD : config.workerCount;
 
-	if (!mDbManager->Init("localhost", 33060, "root", "1234", "chat"))
+	mIOCPHandle = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, mWorkerCount);
+	if (mIOCPHandle == nullptr)
 	{
-		cout << "[IOCPServer] DbManager Init failed" << endl;
+		cout << "[IOCPServer] CreateIoCompletionPort Error" << endl;
 		return false;
 	}
 
-	if (!mDbManager->CreateTables())
+	// 워커 수만큼 우편함을 만들고 세션은 풀 인덱스로 하나씩 배정한다
+	vector<WorkerMailbox*> mailboxes;
+	for (UINT32 i = 0; i < mWorkerCount; i++)
 	{
-		cout << "[IOCPServer] DbManager CreateTables failed" << endl;
-		return false;
+		mMailboxes.emplace_back(make_unique<WorkerMailbox>(mIOCPHandle));
+		mailboxes.push_back(mMailboxes.back().get());
 	}
 
-	if (!mDbManager->ClearTable())
-	{
-		cout << "[IOCPServer] DbManager ClearTable failed" << endl;
+	mSessionManager = new SessionManager(config.maxClientCount, mailboxes);
+	mRoomManager = new RoomManager(MAX_ROOM_COUNT, config.roomHistoryBytes);
+	mRoomManager->SetCompletionPort(mIOCPHandle);
+
+	if (!OpenUserStore(config.userStore))
 		return false;
-	}
 
 	mPacketHandler->SetSessionManager(mSessionManager);
 	mPacketHandler->SetRoomManager(mRoomManager);
-	mPacketHandler->SetDbManager(mDbManager);
-
-	mIOCPHandle = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, MAX_WORKERTHREAD);
-	if (mIOCPHandle == nullptr)
+	mPacketHandler->SetUserStore(mUserStore);
+
+	// 로그인/가입의 DB 왕복은 I/O 워커 대신 전용 스레드에서 처리한다
+	mDbExecutor = new TaskExecutor("DB", DB_EXECUTOR_THREADS, DB_EXECUTOR_QUEUE_LIMIT);
+	mPacketHandler->SetDbExecutor(mDbExecutor);
+
+	// 비밀번호 해시는 일부러 느린 연산이라 DB 대기와도 섞지 않고 따로 묶어 둔다.
+	// 기다리는 일 없이 CPU만 쓰므로 코어 수보다 많으면 문맥 전환만 늘고, 적으면 폭주 때 코어가 논다
+	UINT32 cryptoThreads = max(thread::hardware_concurrency(), 1u);
+	mCryptoExecutor = new TaskExecutor("Crypto", cryptoThreads, CRYPTO_EXECUTOR_QUEUE_LIMIT);
+	mPacketHandler->SetCryptoExecutor(mCryptoExecutor);
+
+	// 재접속/가입 폭주 때 실행기 큐가 차지 않도록 로그인과 가입을 한 줄에 세운다
+	UINT32 authMaxInFlight = (DB_EXECUTOR_THREADS + cryptoThreads) * AUTH_IN_FLIGHT_PER_THREAD;
+	mAuthAdmission = new AdmissionQueue(authMaxInFlight, AUTH_QUEUE_LIMIT, AUTH_QUEUE_TIMEOUT_MS);
+	mPacketHandler->SetAuthAdmission(mAuthAdmission);
+	mPacketHandler->SetRegisterBatching(config.registerBatching);
+	mPacketHandler->SetMaxRoomUserCount(config.maxRoomUserCount);
+
+	if (config.chatLog)
 	{
-		cout << "[IOCPServer] CreateIoCompletionPort Error" << endl;
-		return false;
+		mChatLog = new ChatLog();
+		if (!mChatLog->Open(config.chatLogDirectory))
+		{
+			cout << "[IOCPServer] ChatLog Open failed" << endl;
+			return false;
+		}
+
+		mPacketHandler->SetChatLog(mChatLog);
 	}
 
-	for (int i = 0; i < MAX_WORKERTHREAD; i++)
+	for (UINT32 i = 0; i < mWorkerCount; i++)
 	{
 		mIOWorkerThreads.emplace_back([this]() { WorkerThread(); });
 	}
 
 	mAcceptThread = thread([this]() { AcceptThread(); });
 
-	cout << "[IOCPServer] Server startew with " << MAX_WORKERTHREAD << " worker threads" << endl;
+	cout << "[IOCPServer] Server startew with " << mWorkerCount << " worker threads" << endl;
 	return true;
 }
 
@@ -126,6 +167,24 @@ void IOCPServer::StopServer()
 	if (mAcceptThread.joinable())
 		mAcceptThread.join();
 
+	// 만료 타이머가 워커가 멈춘 뒤 우편함에 거절을 게시하지 않도록 먼저 끈다
+	if (mAuthAdmission != nullptr)
+		mAuthAdmission->Stop();
+
+	// 남은 작업의 완료 통지가 우편함으로 들어갈 수 있도록 워커보다 먼저 멈춘다.
+	// 순서는 접속 받기 -> DB -> 암호. 로그인은 DB 조회 뒤 암호 실행기로 검증을 넘기므로
+	// DB 실행기를 비우는 동안 암호 실행기가 살아 있어야 마지막 조회까지 검증된다.
+	// 반대로 가입은 해시 뒤 DB로 넘어가는데, 그때 DB 실행기가 멈췄으면 거절되어 SERVER_BUSY로 답한다.
+	// 일괄 가입 스레드는 암호 실행기가 넘긴 가입까지 쓰도록 맨 뒤에 멈춘다
+	if (mDbExecutor != nullptr)
+		mDbExecutor->Stop();
+
+	if (mCryptoExecutor != nullptr)
+		mCryptoExecutor->Stop();
+
+	if (mUserStore != nullptr)
+		mUserStore->Stop();
+
 	for (int i = 0; i < mIOWorkerThreads.size(); ++i)
 	{
 		PostQueuedCompletionStatus(mIOCPHandle, 0, 0, nullptr);
@@ -141,6 +200,10 @@ void IOCPServer::StopServer()
 
 	mSessionManager->CloseAllSessions();
 
+	// Append는 워커에서만 부르므로 워커가 모두 멈춘 뒤 닫는다
+	if (mChatLog != nullptr)
+		mChatLog->Close();
+
 	if (mIOCPHandle != nullptr)
 	{
 		CloseHandle(mIOCPHandle);
@@ -150,6 +213,90 @@ void IOCPServer::StopServer()
 	cout << "[IOCPServer] Stop Server..." << endl;
 }
 
+static void PrintExecutorStats(TaskExecutor* executor)
+{
+	if (executor == nullptr)
+		return;
+
+	TaskExecutorStats stats = executor->GetStats();
+	uint64_t avgWaitUs = stats.completed > 0 ? stats.totalWaitUs / stats.completed : 0;
+	uint64_t avgRunUs = stats.completed > 0 ? stats.totalRunUs / stats.completed : 0;
+
+	cout << "[Stats] " << executor->GetName() << " executor: completed " << stats.completed << "/" << stats.submitted
+		<< ", rejected " << stats.rejected << ", queue " << stats.queueDepth
+		<< " (max " << stats.maxQueueDepth << "), avg wait " << avgWaitUs << "us, avg run " << avgRunUs << "us" << endl;
+}
+
+void IOCPServer::PrintStats()
+{
+	// 로그인은 입장 대기열 -> DB 실행기 -> 암호 실행기, 가입은 입장 대기열 -> 암호 실행기 -> DB 순서로 지나간다
+	if (mAuthAdmission != nullptr)
+	{
+		AdmissionStats stats = mAuthAdmission->GetStats();
+		uint64_t avgWaitUs = stats.queued > 0 ? stats.totalQueueWaitUs / stats.queued : 0;
+		uint64_t avgServiceUs = stats.completed > 0 ? stats.totalServiceUs / stats.completed : 0;
+
+		cout << "[Stats] auth admission: in flight " << stats.inFlight << ", queue " << stats.queueDepth
+			<< " (max " << stats.maxQueueDepth << "), started " << stats.started << ", queued " << stats.queued
+			<< ", rejected " << stats.rejected << ", expired " << stats.expired << ", cancelled " << stats.cancelled
+			<< ", avg wait " << avgWaitUs << "us, avg service " << avgServiceUs << "us" << endl;
+	}
+
+	PrintExecutorStats(mDbExecutor);
+	PrintExecutorStats(mCryptoExecutor);
+
+	if (mUserStore != nullptr)
+		mUserStore->PrintStats();
+
+	if (mChatLog != nullptr)
+	{
+		ChatLogStats stats = mChatLog->GetStats();
+		cout << "[Stats] chat log: synced " << stats.synced << "/" << stats.appended << " records ("
+			<< stats.bytesWritten / 1024 << " KB), dropped " << stats.dropped << ", " << stats.syncCount
+			<< " syncs, segment " << stats.segmentIndex << endl;
+	}
+}
+
+bool IOCPServer::OpenUserStore(const UserStoreConfig& config)
+{
+	if (config.type == UserStoreType::MEMORY)
+	{
+		mUserStore = new MemoryUserStore();
+		cout << "[IOCPServer] Using in-memory user store" << endl;
+		return true;
+	}
+
+	if (config.user.empty() || config.password.empty())
+	{
+		cout << "[IOCPServer] DB credentials missing: set " << DB_USER_ENV << " / " << DB_PASSWORD_ENV
+			<< " or pass --db-credentials <file>" << endl;
+		return false;
+	}
+
+	DbManager* dbManager = new DbManager();
+	mUserStore = dbManager;
+
+	if (!dbManager->Init(config.host, config.port, config.user, config.password, config.schema, DB_EXECUTOR_THREADS))
+	{
+		cout << "[IOCPServer] DbManager Init failed" << endl;
+		return false;
+	}
+
+	if (!dbManager->CreateTables())
+	{
+		cout << "[IOCPServer] DbManager CreateTables failed" << endl;
+		return false;
+	}
+
+	if (!dbManager->ClearTable())
+	{
+		cout << "[IOCPServer] DbManager ClearTable failed" << endl;
+		return false;
+	}
+
+	return true;
+}
+
 bool IOCPServer::BindIOCompletionPort(ClientSession* session)
 {
 	HANDLE handle = CreateIoCompletionPort(
@@ -179,7 +326,7 @@ void IOCPServer::DisconnectSession(ClientSession* session)
 void IOCPServer::WorkerThread()
 {
 	DWORD transferred = 0;
-	ClientSession* session = nullptr;
+	ULONG_PTR completionKey = 0;
 	LPOVERLAPPED overlapped = nullptr;
 
 	while (true)
@@ -187,7 +334,7 @@ void IOCPServer::WorkerThread()
 		BOOL success = GetQueuedCompletionStatus(
 			mIOCPHandle,
 			&transferred,
-			(PULONG_PTR)&session,
+			&completionKey,
 			&overlapped,
 			INFINITE
 		);
@@ -195,43 +342,81 @@ void IOCPServer::WorkerThread()
 		if (overlapped == nullptr)
 			break;
 
-		if (!success || transferred == 0)
-		{
-			DWORD err = GetLastError();
-
-			if (!success &&
-				err != ERROR_OPERATION_ABORTED &&
-				err != ERROR_CONNECTION_ABORTED &&
-				err != ERROR_NETNAME_DELETED)
-			{
-				cout << "[IOCP Server] Abnormal Disconnect (Error: " << err << ")\n";
-			}
+		auto overlappedEx = (OverlappedEx*)overlapped;
 
-			if (session->TryDisconnect())
-				DisconnectSession(session);
+		if (overlappedEx->operation == IOOperation::FLUSH_MAILBOX)
+		{
+			reinterpret_cast<WorkerMailbox*>(completionKey)->Flush();
+			continue;
+		}
 
+		if (overlappedEx->operation == IOOperation::ROOM_EXECUTE)
+		{
+			reinterpret_cast<RoomSession*>(completionKey)->Execute();
 			continue;
 		}
 
-		auto overlappedEx = (OverlappedEx*)overlapped;
+		auto session = reinterpret_cast<ClientSession*>(completionKey);
+
+		ProcessSessionIo(session, overlappedEx->operation, success, transferred);
 
-		if (overlappedEx->operation == IOOperation::RECV)
+		// Reset 뒤 마지막 완료 통지였으면 여기서 슬롯을 돌려준다
+		if (session->ReleaseIoRef())
+			mSessionManager->FreeSession(session);
+	}
+}
+
+void IOCPServer::ProcessSessionIo(ClientSession* session, IOOperation operation, BOOL success, DWORD transferred)
+{
+	// 0바이트 수신 대기는 transferred == 0 이 정상 완료다
+	if (!success || (transferred == 0 && operation != IOOperation::RECV_ZERO))
+	{
+		DWORD err = GetLastError();
+
+		if (!success &&
+			err != ERROR_OPERATION_ABORTED &&
+			err != ERROR_CONNECTION_ABORTED &&
+			err != ERROR_NETNAME_DELETED)
 		{
-			session->GetRecvBuffer().Write(session->GetTempRecvBuf(), transferred);
+			cout << "[IOCP Server] Abnormal Disconnect (Error: " << err << ")\n";
+		}
+
+		if (operation == IOOperation::RECV)
+			session->OnRecvCompleted(0);
 
-			bool packetOk = mPacketHandler->ProcessPacket(session);
+		if (session->TryDisconnect())
+			DisconnectSession(session);
 
-			if (!packetOk || !session->RegisterRecv())
-			{
-				if (session->TryDisconnect())
-					DisconnectSession(session);
-			}
+		return;
+	}
+
+	if (operation == IOOperation::RECV_ZERO)
+	{
+		if (!session->RecvData())
+		{
+			if (session->TryDisconnect())
+				DisconnectSession(session);
 		}
-		else if (overlappedEx->operation == IOOperation::SEND)
+	}
+	else if (operation == IOOperation::RECV)
+	{
+		if (!session->OnRecvCompleted(transferred))
+			return;
+
+		bool packetOk = mPacketHandler->ProcessPacket(session);
+
+		session->ReleaseIdleRecvBuffer();
+
+		if (!packetOk || !session->RegisterRecv())
 		{
-			session->OnSendCompleted();
+			if (session->TryDisconnect())
+				DisconnectSession(session);
 		}
 	}
+	else if (operation == IOOperation::SEND)
+	{
+		session->OnSendCompleted();
+	}
 }
 
 void IOCPServer::AcceptThread()
@@ -258,13 +443,13 @@ void IOCPServer::AcceptThread()
 
 		if (!BindIOCompletionPort(session))
 		{
-			session->Reset();
+			mSessionManager->ReleaseSession(session);
 			continue;
 		}
 
 		if (!session->RegisterRecv())
 		{
-			session->Reset();
+			mSessionManager->ReleaseSession(session);
 			continue;
 		}
 
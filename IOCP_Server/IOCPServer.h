@@ -8,14 +8,37 @@
 #include <iostream>
 
 #include "ClientSession.h"
+#include "WorkerMailbox.h"
 #include "SessionManager.h"
 #include "PacketHandler.h"
 #include "DbManager.h"
+#include "MemoryUserStore.h"
+#include "TaskExecutor.h"
+#include "ChatLog.h"
+#include "AdmissionQueue.h"
 
 #define MAX_WORKERTHREAD 4
+#define DB_EXECUTOR_THREADS DB_POOL_SIZE	// 실행기 스레드와 풀 연결을 같은 수로 맞춘다
+#define DB_EXECUTOR_QUEUE_LIMIT 4096	// 넘으면 로그인/가입을 바로 SERVER_BUSY로 돌려준다
+#define CRYPTO_EXECUTOR_QUEUE_LIMIT 1024	// 스레드 수는 코어 수 (해시/검증은 CPU만 쓴다)
+#define AUTH_IN_FLIGHT_PER_THREAD 2	// 실행기 스레드(DB + 암호)당 동시에 진행할 로그인/가입. 실행기 큐가 짧게 유지될 만큼만
+#define AUTH_QUEUE_LIMIT 2048			// 넘으면 SERVER_BUSY로 바로 돌려준다 (로그인은 retryAfterMs도)
+#define AUTH_QUEUE_TIMEOUT_MS 2000		// 이보다 오래 기다린 요청은 클라이언트가 포기했다고 보고 시작하지 않는다
 
 using namespace std;
 
+struct ServerConfig
+{
+    UINT32 maxClientCount = 10000;          // 세션 풀 상한 (청크 단위로 필요할 때 확장)
+    UINT32 workerCount = MAX_WORKERTHREAD;
+    bool registerBatching = true;           // 가입을 모아 여러 행 INSERT로 쓴다
+    size_t roomHistoryBytes = ROOM_HISTORY_BYTES;   // 방마다 최근 채팅을 담는 바이트 상한 (0이면 기록하지 않음)
+    uint16_t maxRoomUserCount = ROOM_MAX_USER_LIMIT;    // 방 생성 요청의 maxUser 상한 (하한은 2)
+    UserStoreConfig userStore;
+    bool chatLog = true;                    // 로비/귓속말/방 채팅을 세그먼트 로그에 남긴다
+    string chatLogDirectory = "chatlog";
+};
+
 class IOCPServer
 {
 public:
@@ -24,26 +47,37 @@ public:
 
     bool InitSocket();
     bool BindAndListen(int bindPort);
-    bool StartServer(UINT32 maxClientCount);
+    bool StartServer(const ServerConfig& config);
     void StopServer();
 
+    // 콘솔 stats 명령으로 실행기들, 계정 저장소, 채팅 로그 상태를 찍는다
+    void PrintStats();
+
 private:
     SOCKET mListenSocket;
     HANDLE mIOCPHandle;
+    UINT32 mWorkerCount;
     vector<thread> mIOWorkerThreads;
     thread mAcceptThread;
+    vector<unique_ptr<WorkerMailbox>> mMailboxes;
 
     SessionManager* mSessionManager;
     RoomManager* mRoomManager;
     PacketHandler* mPacketHandler;
-    DbManager* mDbManager;
+    UserStore* mUserStore;
+    TaskExecutor* mDbExecutor;
+    TaskExecutor* mCryptoExecutor;
+    ChatLog* mChatLog;
+    AdmissionQueue* mAuthAdmission;
 
     UINT32 mSessionIdCounter;
     atomic<bool> mIsAcceptRun;
 
     void WorkerThread();
+    void ProcessSessionIo(ClientSession* session, IOOperation operation, BOOL success, DWORD transferred);
     void AcceptThread();
     void DisconnectSession(ClientSession* session);
+    bool OpenUserStore(const UserStoreConfig& config);
 
     bool BindIOCompletionPort(ClientSession* session);
     UINT32 GenerateSessionId() { return mSessionIdCounter++; }
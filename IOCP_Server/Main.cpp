@@ -1,10 +1,239 @@
 
 #include "IOCPServer.h"
+#include <Psapi.h>
+#include <chrono>
+#include <algorithm>
+#include <fstream>
+#pragma comment(lib, "psapi")
+
+static SIZE_T GetPrivateBytes()
+{
+	PROCESS_MEMORY_COUNTERS_EX counters{};
+	GetProcessMemoryInfo(GetCurrentProcess(), (PROCESS_MEMORY_COUNTERS*)&counters, sizeof(counters));
+	return counters.PrivateUsage;
+}
+
+// 빈 방 roomCount개를 풀에 만들어 두고 방 하나당 메모리를 잰다
+static void RunRoomMemoryBenchmark(uint32_t roomCount)
+{
+	SIZE_T before = GetPrivateBytes();
+	auto start = chrono::high_resolution_clock::now();
+
+	RoomManager roomManager(roomCount);
+	roomManager.Reserve(roomCount);
+
+	auto end = chrono::high_resolution_clock::now();
+	SIZE_T after = GetPrivateBytes();
+
+	size_t reserved = roomManager.GetReservedRoomCount();
+	double bytesPerRoom = reserved > 0 ? (double)(after - before) / reserved : 0.0;
+
+	cout << "[RoomBench] rooms: " << reserved << endl;
+	cout << "[RoomBench] sizeof(RoomSession): " << sizeof(RoomSession) << " bytes" << endl;
+	cout << "[RoomBench] private bytes: " << (after - before) / 1024 << " KB ("
+		<< bytesPerRoom << " bytes/room)" << endl;
+	cout << "[RoomBench] elapsed: " << chrono::duration_cast<chrono::milliseconds>(end - start).count() << "ms" << endl;
+}
+
+// threadCount개 스레드가 채팅 크기의 레코드를 쏟아 넣고 디스크에 동기화된 처리량과 Append 지연을 잰다
+static void RunChatLogBenchmark(uint32_t messageCount, uint32_t threadCount)
+{
+	threadCount = max(threadCount, 1u);
+	const string message(64, 'x');
+
+	ChatLog chatLog;
+	if (!chatLog.Open("chatlog_bench"))
+		return;
+
+	uint32_t firstSegment = chatLog.GetStats().segmentIndex;
+
+	vector<vector<long long>> appendNs(threadCount);
+	vector<thread> threads;
+
+	auto start = chrono::high_resolution_clock::now();
+
+	for (uint32_t t = 0; t < threadCount; t++)
+	{
+		threads.emplace_back([&, t]()
+		{
+			string sender = "BenchUser" + to_string(t);
+			for (uint32_t i = t; i < messageCount; i += threadCount)
+			{
+				auto appendStart = chrono::high_resolution_clock::now();
+				chatLog.Append(ChatLogType::ROOM, sender, string_view(), t + 1, message);
+				appendNs[t].push_back(chrono::duration_cast<chrono::nanoseconds>(
+					chrono::high_resolution_clock::now() - appendStart).count());
+			}
+		});
+	}
+
+	for (auto& benchThread : threads)
+		benchThread.join();
+
+	auto appended = chrono::high_resolution_clock::now();
+
+	// 남은 레코드를 쓰고 동기화할 때까지 기다린 시점까지를 처리량 구간으로 본다
+	chatLog.Close();
+	auto end = chrono::high_resolution_clock::now();
+
+	vector<long long> latencies;
+	for (auto& samples : appendNs)
+		latencies.insert(latencies.end(), samples.begin(), samples.end());
+	sort(latencies.begin(), latencies.end());
+
+	auto percentile = [&latencies](double p) -> long long
+	{
+		return latencies.empty() ? 0 : latencies[min(latencies.size() - 1, (size_t)(latencies.size() * p))];
+	};
+
+	// 이번 실행에서 쓴 세그먼트만 매핑해 다시 세어 본다 (이름 끝이 <번호>.log)
+	ChatLogStats stats = chatLog.GetStats();
+	uint64_t readBack = 0;
+	for (const string& path : ChatLog::ListSegments("chatlog_bench"))
+	{
+		if (strtoul(path.c_str() + path.size() - 12, nullptr, 10) >= firstSegment)
+			ChatLog::ReadSegment(path, [&readBack](const ChatLogRecord&) { readBack++; return true; });
+	}
+
+	auto totalMs = chrono::duration_cast<chrono::milliseconds>(end - start).count();
+	auto appendMs = chrono::duration_cast<chrono::milliseconds>(appended - start).count();
+
+	cout << "[ChatLogBench] threads: " << threadCount << ", messages: " << messageCount << endl;
+	cout << "[ChatLogBench] appended in " << appendMs << "ms, synced " << stats.synced << " in " << totalMs << "ms ("
+		<< (totalMs > 0 ? stats.synced * 1000 / totalMs : 0) << " msgs/sec), dropped " << stats.dropped << endl;
+	cout << "[ChatLogBench] syncs: " << stats.syncCount << " ("
+		<< (stats.syncCount > 0 ? stats.synced / stats.syncCount : 0) << " records/sync)" << endl;
+	cout << "[ChatLogBench] append latency p50: " << percentile(0.50) << "ns, p99: " << percentile(0.99)
+		<< "ns, max: " << (latencies.empty() ? 0 : latencies.back()) << "ns" << endl;
+	cout << "[ChatLogBench] records read back from segments: " << readBack << endl;
+}
+
+// 세그먼트를 매핑해 레코드를 출력한다
+static void DumpChatLog(const string& directory)
+{
+	static const char* typeNames[] = { "LOBBY", "WHISPER", "ROOM" };
+
+	for (const string& path : ChatLog::ListSegments(directory))
+	{
+		cout << "== " << path << endl;
+		ChatLog::ReadSegment(path, [](const ChatLogRecord& record)
+		{
+			const ChatLogRecordHeader* header = record.header;
+			cout << header->sequence << " " << header->timestampMs << " "
+				<< typeNames[min((size_t)header->type, (size_t)2)] << " room=" << header->roomId
+				<< " " << record.sender;
+			if (!record.target.empty())
+				cout << " -> " << record.target;
+			cout << ": " << record.message << endl;
+			return true;
+		});
+	}
+}
+
+static string ReadEnvironment(const char* name)
+{
+	char value[256];
+	DWORD length = GetEnvironmentVariableA(name, value, sizeof(value));
+	return (length > 0 && length < sizeof(value)) ? string(value, length) : string();
+}
+
+// DB 계정/비밀번호를 채운다. path가 있으면 user=, password= 줄로 된 파일에서, 없으면 환경 변수에서 읽는다
+static bool LoadDbCredentials(UserStoreConfig& config, const string& path)
+{
+	if (path.empty())
+	{
+		if (config.user.empty())
+			config.user = ReadEnvironment(DB_USER_ENV);
+		config.password = ReadEnvironment(DB_PASSWORD_ENV);
+		return true;
+	}
+
+	ifstream file(path);
+	if (!file)
+	{
+		cout << "[Main] cannot open DB credentials file: " << path << endl;
+		return false;
+	}
+
+	string line;
+	while (getline(file, line))
+	{
+		if (!line.empty() && line.back() == '\r')
+			line.pop_back();
+
+		if (line.compare(0, 5, "user=") == 0)
+			config.user = line.substr(5);
+		else if (line.compare(0, 9, "password=") == 0)
+			config.password = line.substr(9);
+	}
+
+	return true;
+}
 
 int main(int argc, char* argv[])
 {
 	const UINT16 SERVER_PORT = 11021;
-	const UINT16 MAX_CLIENT = 1000;
+
+	// 사용법: IOCP_Server --room-bench [방 수]
+	if (argc >= 2 && string(argv[1]) == "--room-bench")
+	{
+		uint32_t roomCount = (argc >= 3) ? (uint32_t)atoi(argv[2]) : MAX_ROOM_COUNT;
+		RunRoomMemoryBenchmark(roomCount);
+		return 0;
+	}
+
+	// 사용법: IOCP_Server --chatlog-bench [메시지 수] [스레드 수]
+	if (argc >= 2 && string(argv[1]) == "--chatlog-bench")
+	{
+		uint32_t messageCount = (argc >= 3) ? (uint32_t)atoi(argv[2]) : 1000000;
+		uint32_t threadCount = (argc >= 4) ? (uint32_t)atoi(argv[3]) : MAX_WORKERTHREAD;
+		RunChatLogBenchmark(messageCount, threadCount);
+		return 0;
+	}
+
+	// 사용법: IOCP_Server --chatlog-dump [디렉터리]
+	if (argc >= 2 && string(argv[1]) == "--chatlog-dump")
+	{
+		DumpChatLog((argc >= 3) ? argv[2] : "chatlog");
+		return 0;
+	}
+
+	// 사용법: IOCP_Server [워커 스레드 수] [--no-register-batch] [--memory-store] [--no-chat-log] [--room-history-bytes N] [--max-room-users N]
+	//        [--db-host 주소] [--db-port 포트] [--db-user 계정] [--db-schema 스키마] [--db-credentials 파일]
+	// 비밀번호는 명령줄로 받지 않는다. --db-credentials 파일이나 CHAT_DB_USER / CHAT_DB_PASSWORD 환경 변수로 넘긴다
+	ServerConfig config;
+	string credentialsPath;
+	for (int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+
+		if (arg == "--no-register-batch")
+			config.registerBatching = false;
+		else if (arg == "--memory-store")
+			config.userStore.type = UserStoreType::MEMORY;
+		else if (arg == "--no-chat-log")
+			config.chatLog = false;
+		else if (arg == "--room-history-bytes" && hasValue)
+			config.roomHistoryBytes = (size_t)max(atoi(argv[++i]), 0);	// 0이면 방 기록을 끈다
+		else if (arg == "--max-room-users" && hasValue)
+			config.maxRoomUserCount = (uint16_t)min(max(atoi(argv[++i]), 2), (int)UINT16_MAX);
+		else if (arg == "--db-host" && hasValue)
+			config.userStore.host = argv[++i];
+		else if (arg == "--db-port" && hasValue)
+			config.userStore.port = atoi(argv[++i]);
+		else if (arg == "--db-user" && hasValue)
+			config.userStore.user = argv[++i];
+		else if (arg == "--db-credentials" && hasValue)
+			credentialsPath = argv[++i];
+		else if (arg == "--db-schema" && hasValue)
+			config.userStore.schema = argv[++i];
+		else
+			config.workerCount = (UINT32)atoi(argv[i]);
+	}
+
+	if (config.userStore.type == UserStoreType::MYSQL && !LoadDbCredentials(config.userStore, credentialsPath))
+		return 1;
 
 	IOCPServer server;
 
@@ -14,9 +243,9 @@ int main(int argc, char* argv[])
 	//소켓과 서버 주소를 연결하고 등록 시킨다.
 	server.BindAndListen(SERVER_PORT);
 
-	server.StartServer(MAX_CLIENT);
+	server.StartServer(config);
 
-	printf("Press q or Q to quit\n");
+	printf("Press q or Q to quit, stats to print counters\n");
 	while (true)
 	{
 		string inputCmd;
@@ -26,6 +255,11 @@ int main(int argc, char* argv[])
 		{
 			break;
 		}
+
+		if (inputCmd == "stats")
+		{
+			server.PrintStats();
+		}
 	}
 
 	server.StopServer();
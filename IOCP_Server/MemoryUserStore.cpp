@@ -0,0 +1,51 @@
+#include "MemoryUserStore.h"
+#include "SRWLockGuard.h"
+#include <iostream>
+
+MemoryUserStore::MemoryUserStore()
+	: mNextUserId(1)
+{
+	InitializeSRWLock(&mLock);
+}
+
+DbResult MemoryUserStore::RegisterUser(const string& loginId,
+									   const string& passwordHash,
+									   const string& nickname)
+{
+	SRWLockGuard lock(&mLock);
+
+	if (mUsers.find(loginId) != mUsers.end())
+		return DbResult::DUPLICATE_ID;
+
+	UserRow& user = mUsers[loginId];
+	user.id = mNextUserId++;
+	user.loginId = loginId;
+	user.passwordHash = passwordHash;
+	user.nickname = nickname;
+
+	return DbResult::OK;
+}
+
+bool MemoryUserStore::EnqueueRegister(string loginId, string passwordHash, string nickname, RegisterCallback done)
+{
+	done(RegisterUser(loginId, passwordHash, nickname));
+	return true;
+}
+
+DbResult MemoryUserStore::FindUser(const string& loginId, UserRow& outUser)
+{
+	SRWLockGuard lock(&mLock, false);
+
+	auto it = mUsers.find(loginId);
+	if (it == mUsers.end())
+		return DbResult::USER_NOT_FOUND;
+
+	outUser = it->second;
+	return DbResult::OK;
+}
+
+void MemoryUserStore::PrintStats()
+{
+	SRWLockGuard lock(&mLock, false);
+	cout << "[Stats] memory user store: " << mUsers.size() << " users" << endl;
+}
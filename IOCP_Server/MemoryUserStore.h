@@ -0,0 +1,37 @@
+#pragma once
+#include <Windows.h>
+#include <unordered_map>
+#include "UserStore.h"
+
+// 프로세스 메모리에만 두는 계정 저장소. MySQL 없이 부하 테스트를 돌리거나 단일 서버로 띄울 때 쓴다.
+// 조회는 공유 락, 가입은 배타 락으로 맵 하나를 보호한다.
+class MemoryUserStore : public UserStore
+{
+public:
+	MemoryUserStore();
+	~MemoryUserStore() override = default;
+
+	MemoryUserStore(const MemoryUserStore&) = delete;
+	MemoryUserStore& operator=(const MemoryUserStore&) = delete;
+
+	DbResult RegisterUser(const string& loginId,
+						  const string& passwordHash,
+						  const string& nickname) override;
+
+	// 모을 필요가 없으므로 부른 스레드에서 바로 넣고 done을 부른다
+	bool EnqueueRegister(string loginId, string passwordHash, string nickname, RegisterCallback done) override;
+
+	DbResult FindUser(const string& loginId, UserRow& outUser) override;
+
+	// 원본이 곧 이 맵이라 지울 캐시가 없다
+	void InvalidateUser(const string& loginId) override {}
+
+	bool IsConnected() const override { return true; }
+	void Stop() override {}
+	void PrintStats() override;
+
+private:
+	SRWLOCK mLock;
+	unordered_map<string, UserRow> mUsers;	// loginId -> 계정, mLock
+	long long mNextUserId;					// mLock
+};
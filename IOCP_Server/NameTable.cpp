@@ -0,0 +1,85 @@
+#include "NameTable.h"
+#include "SRWLockGuard.h"
+
+static_assert(NAME_BLOB_SIZE == MAX_USER_NAME + 1, "name blob must match packet name field width");
+
+NameTable::NameTable()
+{
+	InitializeSRWLock(&mSrwLock);
+
+	// 0번은 빈 이름으로 예약
+	mEntries.emplace_back();
+}
+
+const NameEntry* NameTable::Empty()
+{
+	static const NameEntry empty;
+	return &empty;
+}
+
+const NameEntry* NameTable::Intern(string_view name)
+{
+	if (name.empty())
+		return Empty();
+
+	if (name.size() > NAME_BLOB_SIZE - 1)
+		name = name.substr(0, NAME_BLOB_SIZE - 1);
+
+	SRWLockGuard lock(&mSrwLock);
+
+	auto it = mIdByName.find(name);
+	if (it != mIdByName.end())
+	{
+		NameEntry& entry = mEntries[it->second];
+		entry.refCount++;
+		return &entry;
+	}
+
+	NameId id;
+	if (!mFreeIds.empty())
+	{
+		id = mFreeIds.back();
+		mFreeIds.pop_back();
+	}
+	else
+	{
+		id = static_cast<NameId>(mEntries.size());
+		mEntries.emplace_back();
+	}
+
+	NameEntry& entry = mEntries[id];
+	entry.id = id;
+	entry.length = static_cast<uint8_t>(name.size());
+	entry.refCount = 1;
+	memset(entry.blob, 0, sizeof(entry.blob));
+	memcpy(entry.blob, name.data(), name.size());
+
+	mIdByName.emplace(entry.View(), id);
+	return &entry;
+}
+
+void NameTable::Release(const NameEntry* entry)
+{
+	if (entry == nullptr || entry->id == EMPTY_NAME_ID)
+		return;
+
+	SRWLockGuard lock(&mSrwLock);
+
+	NameEntry& target = mEntries[entry->id];
+	if (--target.refCount > 0)
+		return;
+
+	mIdByName.erase(target.View());
+	mFreeIds.push_back(target.id);
+}
+
+NameId NameTable::Find(string_view name)
+{
+	if (name.empty())
+		return EMPTY_NAME_ID;
+
+	SRWLockGuard lock(&mSrwLock, false);
+
+	auto it = mIdByName.find(name);
+	return (it != mIdByName.end()) ? it->second : EMPTY_NAME_ID;
+}
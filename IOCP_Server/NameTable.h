@@ -0,0 +1,51 @@
+#pragma once
+#include <Windows.h>
+#include <string_view>
+#include <unordered_map>
+#include <deque>
+#include <vector>
+#include <algorithm>
+#include "../Common/Common.h"
+
+using namespace std;
+
+using NameId = uint32_t;
+constexpr NameId EMPTY_NAME_ID = 0;
+constexpr size_t NAME_BLOB_SIZE = max(MAX_USER_ID, MAX_USER_NAME) + 1;
+
+// 패킷의 이름 필드(char[MAX_USER_NAME + 1])와 같은 폭으로 0 패딩해 둔 이름.
+// 팬아웃 시 strncpy 대신 blob을 통째로 memcpy 한다.
+struct NameEntry
+{
+	NameId id = EMPTY_NAME_ID;
+	uint8_t length = 0;
+	uint32_t refCount = 0;
+	char blob[NAME_BLOB_SIZE] = {};
+
+	string_view View() const { return string_view(blob, length); }
+};
+
+// 로그인 ID / 닉네임을 참조 카운트로 관리하는 전역 인터닝 테이블.
+// 엔트리 주소는 바뀌지 않으므로 세션은 NameEntry 포인터를 그대로 들고 있는다.
+class NameTable
+{
+public:
+	NameTable();
+	~NameTable() = default;
+
+	NameTable(const NameTable&) = delete;
+	NameTable& operator=(const NameTable&) = delete;
+
+	const NameEntry* Intern(string_view name);
+	void Release(const NameEntry* entry);
+	NameId Find(string_view name);
+
+	static const NameEntry* Empty();
+
+private:
+	deque<NameEntry> mEntries;
+	vector<NameId> mFreeIds;
+	unordered_map<string_view, NameId> mIdByName;	// 키는 mEntries의 blob을 가리킨다
+
+	SRWLOCK mSrwLock;
+};
@@ -55,6 +55,9 @@ bool PacketHandler::ProcessPacket(ClientSession* session)
 		case PacketType::JOIN_ROOM_REQUEST:   if (requireAuth()) HandleJoinRoom(session, fullHeader);   break;
 		case PacketType::LEAVE_ROOM_REQUEST:  if (requireAuth()) HandleLeaveRoom(session, fullHeader);  break;
 		case PacketType::ROOM_CHAT_REQUEST:   if (requireAuth()) HandleRoomChat(session, fullHeader);   break;
+		case PacketType::ROOM_USER_LIST_REQUEST: if (requireAuth()) HandleRoomUserList(session, fullHeader); break;
+		case PacketType::ROOM_SEARCH_REQUEST: if (requireAuth()) HandleRoomSearch(session, fullHeader); break;
+		case PacketType::QUICK_JOIN_REQUEST:  if (requireAuth()) HandleQuickJoin(session, fullHeader);  break;
 
 		default: cout << "[PacketHandler] Unknown packet type" << endl; break;
 		}
@@ -76,9 +79,24 @@ void PacketHandler::SetRoomManager(RoomManager* roomManager)
 	mRoomManager = roomManager;
 }
 
-void PacketHandler::SetDbManager(DbManager* dbManager)
+void PacketHandler::SetDbExecutor(TaskExecutor* dbExecutor)
 {
-	mDbManager = dbManager;
+	mDbExecutor = dbExecutor;
+}
+
+void PacketHandler::SetCryptoExecutor(TaskExecutor* cryptoExecutor)
+{
+	mCryptoExecutor = cryptoExecutor;
+}
+
+void PacketHandler::SetAuthAdmission(AdmissionQueue* authAdmission)
+{
+	mAuthAdmission = authAdmission;
+}
+
+void PacketHandler::SetUserStore(UserStore* userStore)
+{
+	mUserStore = userStore;
 }
 
 ErrorCode PacketHandler::ConvertDbResultToErrorCode(DbResult result)
@@ -89,6 +107,7 @@ ErrorCode PacketHandler::ConvertDbResultToErrorCode(DbResult result)
 	case DbResult::DUPLICATE_ID: return ErrorCode::ID_ALREADY_EXISTS;
 	case DbResult::USER_NOT_FOUND: return ErrorCode::USER_NOT_FOUND;
 	case DbResult::WRONG_PASSWORD: return ErrorCode::WRONG_PASSWORD;
+	case DbResult::BUSY: return ErrorCode::SERVER_BUSY;
 	default: return ErrorCode::SERVER_ERROR;
 	}
 }
@@ -108,14 +127,100 @@ void PacketHandler::HandleRegister(ClientSession* session, PacketHeader* header)
 	string password(packet->password, strnlen_s(packet->password, sizeof(packet->password)));
 	string nickname(packet->nickname, strnlen_s(packet->nickname, sizeof(packet->nickname)));
 
+	if (!session->TryBeginDbRequest())
+	{
+		resPacket.result = ErrorCode::INVALID_STATE;
+		session->SendPacket((char*)&resPacket, sizeof(resPacket));
+		return;
+	}
+
+	// 해시는 암호 실행기, DB 쓰기는 저장소 쪽 스레드에서 하고 결과만 세션의 워커로 돌려보낸다
+	// 실행기 스레드는 세션을 건드리지 않는다. 게시할 우편함과 id는 여기서 잡아 두고,
+	// 세션이 여전히 같은 id로 살아 있는지는 우편함을 비우는 워커가 다시 확인한다
+	uint32_t sessionId = session->GetSessionId();
+	WorkerMailbox* mailbox = session->GetMailbox();
+	SessionRef sessionRef(session);
+	RegisterCallback done = [this, mailbox, sessionRef, sessionId](DbResult dbResult)
+	{
+		mailbox->PostTask(sessionRef, sessionId, [this, dbResult](ClientSession* target)
+		{
+			OnRegisterCompleted(target, dbResult);
+		});
+	};
+
+	// 로그인과 같은 입장 대기열을 지난다. 해시부터 DB 쓰기 결과까지가 자리 하나다
+	auto start = [this, sessionRef, sessionId, loginId, password, nickname, done]() -> AdmissionStart
+	{
+		// 줄을 선 사이 끊긴 세션이면 해시를 돌리지 않는다
+		if (sessionRef->GetSessionId() != sessionId || !sessionRef->IsValid())
+			return AdmissionStart::CANCELLED;
+
+		auto startedAt = chrono::steady_clock::now();
+		RegisterCallback finish = [this, done, startedAt](DbResult dbResult)
+		{
+			mAuthAdmission->Release(chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - startedAt).count());
+			done(dbResult);
+		};
+
+		bool submitted = mCryptoExecutor->Submit([this, loginId, password, nickname, finish]()
+		{
+			string passwordHash = PasswordHasher::Hash(password);
+			if (passwordHash.empty())
+			{
+				finish(DbResult::QUERY_ERROR);
+				return;
+			}
+
+			if (!SubmitRegisterWrite(loginId, passwordHash, nickname, finish))
+				finish(DbResult::BUSY);
+		});
+
+		return submitted ? AdmissionStart::STARTED : AdmissionStart::BUSY;
+	};
+
+	auto reject = [this, mailbox, sessionRef, sessionId](uint32_t retryAfterMs)
+	{
+		mailbox->PostTask(sessionRef, sessionId, [this](ClientSession* target)
+		{
+			target->EndDbRequest();
+			SendRegisterBusy(target);
+		});
+	};
+
+	// 가입 응답에는 재시도 시간 필드가 없으므로 SERVER_BUSY만 알린다
+	uint32_t retryAfterMs = 0;
+	if (!mAuthAdmission->Admit(start, reject, retryAfterMs))
+	{
+		session->EndDbRequest();
+		SendRegisterBusy(session);
+	}
+}
+
+bool PacketHandler::SubmitRegisterWrite(const string& loginId, const string& passwordHash,
+										const string& nickname, const RegisterCallback& done)
+{
+	if (mRegisterBatching)
+		return mUserStore->EnqueueRegister(loginId, passwordHash, nickname, done);
+
+	return mDbExecutor->Submit([this, loginId, passwordHash, nickname, done]()
+	{
+		done(mUserStore->RegisterUser(loginId, passwordHash, nickname));
+	});
+}
 
-	// string passwordHash = Hash(password);
-	string passwordHash = password;
+void PacketHandler::OnRegisterCompleted(ClientSession* session, DbResult dbResult)
+{
+	session->EndDbRequest();
 
-	DbResult dbResult = mDbManager->RegisterUser(loginId, passwordHash, nickname);
-	
+	RegisterResPacket resPacket;
 	resPacket.result = ConvertDbResultToErrorCode(dbResult);
+	session->SendPacket((char*)&resPacket, sizeof(resPacket));
+}
 
+void PacketHandler::SendRegisterBusy(ClientSession* session)
+{
+	RegisterResPacket resPacket;
+	resPacket.result = ErrorCode::SERVER_BUSY;
 	session->SendPacket((char*)&resPacket, sizeof(resPacket));
 }
 
@@ -140,7 +245,7 @@ void PacketHandler::HandleLogin(ClientSession* session, PacketHeader* header)
 	string loginId(packet->loginId, strnlen_s(packet->loginId, sizeof(packet->loginId)));
 	string password(packet->password, strnlen_s(packet->password, sizeof(packet->password)));
 
-	if (mSessionManager->FindSessionByLoginId(loginId) != nullptr)
+	if (mSessionManager->FindSessionByLoginId(loginId))
 	{
 		resPacket.result = ErrorCode::ALREADY_LOGGED_IN;
 		cout << "[PacketHandler] Login failed - Already logged in: " << loginId << endl;
@@ -148,25 +253,118 @@ void PacketHandler::HandleLogin(ClientSession* session, PacketHeader* header)
 		return;
 	}
 
-	string passwordHash = password;
+	if (!session->TryBeginDbRequest())
+	{
+		resPacket.result = ErrorCode::INVALID_STATE;
+		session->SendPacket((char*)&resPacket, sizeof(resPacket));
+		return;
+	}
+
+	// 입장 대기열에서 자리를 받으면 조회는 DB 실행기, 비밀번호 검증은 암호 실행기에서 하고
+	// 결과만 세션의 워커로 돌려보낸다. 결과가 나오는 즉시 자리를 다음 대기자에게 넘긴다
+	// 등록과 같은 이유로 우편함과 id를 미리 잡아 둔다
+	uint32_t sessionId = session->GetSessionId();
+	WorkerMailbox* mailbox = session->GetMailbox();
+	SessionRef sessionRef(session);
+	auto complete = [this, mailbox, sessionRef, sessionId](DbResult dbResult, const UserRow& user)
+	{
+		mailbox->PostTask(sessionRef, sessionId, [this, dbResult, user](ClientSession* target)
+		{
+			OnLoginCompleted(target, dbResult, user);
+		});
+	};
+
+	auto start = [this, sessionRef, sessionId, loginId, password, complete]() -> AdmissionStart
+	{
+		// 줄을 선 사이 끊긴 세션이면 조회와 검증을 하지 않는다
+		if (sessionRef->GetSessionId() != sessionId || !sessionRef->IsValid())
+			return AdmissionStart::CANCELLED;
+
+		auto startedAt = chrono::steady_clock::now();
+		auto finish = [this, complete, startedAt](DbResult dbResult, const UserRow& user)
+		{
+			mAuthAdmission->Release(chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - startedAt).count());
+			complete(dbResult, user);
+		};
+
+		bool submitted = mDbExecutor->Submit([this, loginId, password, finish]()
+		{
+			UserRow user{};
+			DbResult dbResult = mUserStore->FindUser(loginId, user);
+			user.loginId = loginId;
+
+			if (dbResult != DbResult::OK)
+			{
+				finish(dbResult, user);
+				return;
+			}
+
+			bool verifying = mCryptoExecutor->Submit([password, user, finish]()
+			{
+				finish(PasswordHasher::Verify(password, user.passwordHash) ? DbResult::OK : DbResult::WRONG_PASSWORD, user);
+			});
+
+			if (!verifying)
+				finish(DbResult::BUSY, user);
+		});
+
+		return submitted ? AdmissionStart::STARTED : AdmissionStart::BUSY;
+	};
+
+	auto reject = [this, mailbox, sessionRef, sessionId](uint32_t retryAfterMs)
+	{
+		mailbox->PostTask(sessionRef, sessionId, [this, retryAfterMs](ClientSession* target)
+		{
+			target->EndDbRequest();
+			SendLoginBusy(target, retryAfterMs);
+		});
+	};
+
+	uint32_t retryAfterMs = 0;
+	if (!mAuthAdmission->Admit(start, reject, retryAfterMs))
+	{
+		session->EndDbRequest();
+		SendLoginBusy(session, retryAfterMs);
+	}
+}
+
+void PacketHandler::SendLoginBusy(ClientSession* session, uint32_t retryAfterMs)
+{
+	LoginResPacket resPacket;
+	resPacket.result = ErrorCode::SERVER_BUSY;
+	resPacket.retryAfterMs = static_cast<uint16_t>(min(retryAfterMs, (uint32_t)UINT16_MAX));
+	session->SendPacket((char*)&resPacket, sizeof(resPacket));
+}
+
+void PacketHandler::OnLoginCompleted(ClientSession* session, DbResult dbResult, const UserRow& user)
+{
+	session->EndDbRequest();
 
-	UserRow user{};
-	DbResult dbResult = mDbManager->LoginUser(loginId, passwordHash, user);
+	LoginResPacket resPacket;
+
+	// 검증 단계에서 암호 실행기가 받지 못한 경우
+	if (dbResult == DbResult::BUSY)
+	{
+		SendLoginBusy(session, mAuthAdmission->GetRetryAfterMs());
+		return;
+	}
 
 	if (dbResult != DbResult::OK)
 	{
 		resPacket.result = ConvertDbResultToErrorCode(dbResult);
-		cout << "[PacketHandler] Login failed: " << loginId
+		cout << "[PacketHandler] Login failed: " << user.loginId
 			<< ", result = " << static_cast<UINT16>(resPacket.result) << endl;
 		session->SendPacket((char*)&resPacket, sizeof(resPacket));
 		return;
 	}
 
-	session->SetState(SessionState::AUTHENTICATED);
-	session->SetLoginId(user.loginId);
-	session->SetUsername(user.nickname);
-
-	mSessionManager->RegisterSession(session);
+	// DB를 기다리는 동안 같은 아이디가 다른 세션으로 먼저 들어왔을 수 있다
+	if (!mSessionManager->TryRegisterSession(session, user.loginId, user.nickname))
+	{
+		resPacket.result = ErrorCode::ALREADY_LOGGED_IN;
+		session->SendPacket((char*)&resPacket, sizeof(resPacket));
+		return;
+	}
 
 	resPacket.result = ErrorCode::SUCCESS;
 	strcpy_s(resPacket.nickname, sizeof(resPacket.nickname), user.nickname.c_str());
@@ -187,6 +385,12 @@ void PacketHandler::HandleLobbyChat(ClientSession* session, PacketHeader* header
 	LobbyChatResPacket resPacket;
 	resPacket.result = mSessionManager->LobbyChat(session, packet->message);
 	session->SendPacket((char*)&resPacket, sizeof(resPacket));
+
+	if (mChatLog != nullptr && resPacket.result == ErrorCode::SUCCESS)
+	{
+		mChatLog->Append(ChatLogType::LOBBY, session->GetLoginId(), string_view(), 0,
+			string_view(packet->message, strnlen_s(packet->message, sizeof(packet->message))));
+	}
 }
 
 void PacketHandler::HandleWhisper(ClientSession* session, PacketHeader* header)
@@ -202,6 +406,13 @@ void PacketHandler::HandleWhisper(ClientSession* session, PacketHeader* header)
 	WhisperChatResPacket resPacket;
 	resPacket.result = mSessionManager->WhisperChat(session, packet->receiver, packet->message);
 	session->SendPacket((char*)&resPacket, sizeof(resPacket));
+
+	if (mChatLog != nullptr && resPacket.result == ErrorCode::SUCCESS)
+	{
+		mChatLog->Append(ChatLogType::WHISPER, session->GetLoginId(),
+			string_view(packet->receiver, strnlen_s(packet->receiver, sizeof(packet->receiver))), 0,
+			string_view(packet->message, strnlen_s(packet->message, sizeof(packet->message))));
+	}
 }
 
 void PacketHandler::HandleCreateRoom(ClientSession* session, PacketHeader* header)
@@ -214,20 +425,22 @@ void PacketHandler::HandleCreateRoom(ClientSession* session, PacketHeader* heade
 
 	CreateRoomReqPacket* packet = (CreateRoomReqPacket*)header;
 
-	CreateRoomResPacket resPacket;
+	string_view roomName(packet->roomName, strnlen_s(packet->roomName, sizeof(packet->roomName)));
 
-	auto result = mRoomManager->CreateRoomSession(session, packet->roomName, packet->maxUser);
-	if (result.has_value())
+	// 방장 혼자인 방(0, 1)은 처음부터 찬 방이 되고, 너무 큰 값은 인원 카운터를 넘길 수 있다
+	auto result = ErrorCode::INVALID_ROOM_REQUEST;
+	if (packet->maxUser >= 2 && packet->maxUser <= mMaxRoomUserCount)
 	{
-		resPacket.room = result.value();
-		resPacket.result = ErrorCode::SUCCESS;
+		// 성공 응답은 방 작업 큐가 방장 입장 후 보낸다
+		result = mRoomManager->CreateRoomSession(session, roomName, packet->maxUser);
 	}
-	else
+
+	if (result != ErrorCode::SUCCESS)
 	{
-		resPacket.result = ErrorCode::ROOM_CREATION_FAIL;
+		CreateRoomResPacket resPacket;
+		resPacket.result = result;
+		session->SendPacket((char*)&resPacket, sizeof(resPacket));
 	}
-
-	session->SendPacket((char*)&resPacket, sizeof(resPacket));
 }
 
 void PacketHandler::HandleRoomList(ClientSession* session, PacketHeader* header)
@@ -240,22 +453,8 @@ void PacketHandler::HandleRoomList(ClientSession* session, PacketHeader* header)
 
 	RoomListReqPacket* packet = (RoomListReqPacket*)header;
 
-	RoomListResPacket resPacket;
-
-	auto result = mRoomManager->GetRoomListByPage(packet->page);
-
-	if (result.has_value())
-	{
-		resPacket.result = ErrorCode::SUCCESS;
-		resPacket.roomCount = static_cast<uint16_t>(result->size());
-		memcpy_s(resPacket.rooms, sizeof(resPacket.rooms), result->data(), result->size() * sizeof(RoomInfo));
-	}
-	else
-	{
-		resPacket.result = ErrorCode::INVALID_ROOM_REQUEST;
-	}
-
-	session->SendPacket((char*)&resPacket, sizeof(resPacket));
+	// 캐시된 페이지 바이트를 그대로 보낸다. 커서 뒤에 방이 없으면 빈 페이지다
+	session->SendPacket(mRoomManager->GetRoomListPage(packet->cursor));
 }
 
 void PacketHandler::HandleJoinRoom(ClientSession* session, PacketHeader* header)
@@ -268,19 +467,30 @@ void PacketHandler::HandleJoinRoom(ClientSession* session, PacketHeader* header)
 
 	auto* packet = reinterpret_cast<JoinRoomReqPacket*>(header);
 
-	JoinRoomResPacket resPacket;
-
-	auto [result, room] = mRoomManager->JoinRoom(session, packet->roomId);
-
-	resPacket.result = result;
+	auto result = mRoomManager->JoinRoom(session, packet->roomId);
+	if (result != ErrorCode::SUCCESS)
+	{
+		JoinRoomResPacket resPacket;
+		resPacket.result = result;
+		session->SendPacket((char*)&resPacket, sizeof(JoinRoomResPacket));
+	}
+}
 
-	if (result == ErrorCode::SUCCESS)
+void PacketHandler::HandleQuickJoin(ClientSession* session, PacketHeader* header)
+{
+	if (header->GetSize() != sizeof(QuickJoinReqPacket))
 	{
-		resPacket.room = room->ToRoomInfo();
-		room->FillUserList(resPacket.users, MAX_ROOM_USER);
+		cout << "[PacketHandler] QuickJoin packet size error" << endl;
+		return;
 	}
 
-	session->SendPacket((char*)&resPacket, sizeof(JoinRoomResPacket));
+	auto result = mRoomManager->QuickJoin(session);
+	if (result != ErrorCode::SUCCESS)
+	{
+		JoinRoomResPacket resPacket;
+		resPacket.result = result;
+		session->SendPacket((char*)&resPacket, sizeof(JoinRoomResPacket));
+	}
 }
 
 void PacketHandler::HandleLeaveRoom(ClientSession* session, PacketHeader* header)
@@ -291,14 +501,13 @@ void PacketHandler::HandleLeaveRoom(ClientSession* session, PacketHeader* header
 		return;
 	}
 
-	auto* packet = reinterpret_cast<LeaveRoomReqPacket*>(header);
-
 	auto result = mRoomManager->LeaveRoom(session);
-
-	LeaveRoomResPacket resPacket;
-
-	resPacket.result = result;
-	session->SendPacket((char*)&resPacket, sizeof(resPacket));
+	if (result != ErrorCode::SUCCESS)
+	{
+		LeaveRoomResPacket resPacket;
+		resPacket.result = result;
+		session->SendPacket((char*)&resPacket, sizeof(resPacket));
+	}
 }
 
 void PacketHandler::HandleRoomChat(ClientSession* session, PacketHeader* header)
@@ -318,4 +527,44 @@ void PacketHandler::HandleRoomChat(ClientSession* session, PacketHeader* header)
 	resPacket.result = mRoomManager->RoomChat(session, packet->message);
 
 	session->SendPacket((char*)&resPacket, sizeof(RoomChatResPacket));
+
+	if (mChatLog != nullptr && resPacket.result == ErrorCode::SUCCESS)
+	{
+		mChatLog->Append(ChatLogType::ROOM, session->GetLoginId(), string_view(), session->GetRoomId(),
+			string_view(packet->message, strnlen_s(packet->message, sizeof(packet->message))));
+	}
+}
+
+void PacketHandler::HandleRoomUserList(ClientSession* session, PacketHeader* header)
+{
+	if (header->GetSize() != sizeof(RoomUserListReqPacket))
+	{
+		cout << "[PacketHandler] RoomUserList packet size error" << endl;
+		return;
+	}
+
+	auto result = mRoomManager->RequestUserList(session);
+	if (result != ErrorCode::SUCCESS)
+	{
+		RoomUserListResPacket resPacket;
+		resPacket.result = result;
+		session->SendPacket((char*)&resPacket, sizeof(resPacket));
+	}
+}
+
+void PacketHandler::HandleRoomSearch(ClientSession* session, PacketHeader* header)
+{
+	if (header->GetSize() != sizeof(RoomSearchReqPacket))
+	{
+		cout << "[PacketHandler] RoomSearch packet size error" << endl;
+		return;
+	}
+
+	auto* packet = reinterpret_cast<RoomSearchReqPacket*>(header);
+	string_view prefix(packet->prefix, strnlen_s(packet->prefix, sizeof(packet->prefix)));
+
+	RoomSearchResPacket resPacket;
+	resPacket.result = mRoomManager->SearchRoomByPrefix(prefix, packet->page, resPacket);
+
+	session->SendPacket((char*)&resPacket, sizeof(resPacket));
 }
\ No newline at end of file
@@ -3,7 +3,11 @@
 #include "ClientSession.h"
 #include "SessionManager.h"
 #include "RoomManager.h"
-#include "DbManager.h"
+#include "UserStore.h"
+#include "TaskExecutor.h"
+#include "PasswordHasher.h"
+#include "ChatLog.h"
+#include "AdmissionQueue.h"
 #include "../Common/Packet.h"
 
 using namespace std;
@@ -21,7 +25,13 @@ public:
 	
 	void SetSessionManager(SessionManager* sessionManager);
 	void SetRoomManager(RoomManager* roomManager);
-	void SetDbManager(DbManager* dbManager);
+	void SetUserStore(UserStore* userStore);
+	void SetDbExecutor(TaskExecutor* dbExecutor);
+	void SetCryptoExecutor(TaskExecutor* cryptoExecutor);
+	void SetAuthAdmission(AdmissionQueue* authAdmission);
+	void SetChatLog(ChatLog* chatLog) { mChatLog = chatLog; }
+	void SetRegisterBatching(bool enabled) { mRegisterBatching = enabled; }
+	void SetMaxRoomUserCount(uint16_t count) { mMaxRoomUserCount = count; }
 
 private:
 	void HandleLogin(ClientSession* session, PacketHeader* header);
@@ -33,11 +43,30 @@ private:
 	void HandleJoinRoom(ClientSession* session, PacketHeader* header);
 	void HandleLeaveRoom(ClientSession* session, PacketHeader* header);
 	void HandleRoomChat(ClientSession* session, PacketHeader* header);
+	void HandleRoomUserList(ClientSession* session, PacketHeader* header);
+	void HandleRoomSearch(ClientSession* session, PacketHeader* header);
+	void HandleQuickJoin(ClientSession* session, PacketHeader* header);
+
+	// 해시가 끝난 가입을 배치 또는 DB 실행기로 넘긴다. 받지 못하면 false
+	bool SubmitRegisterWrite(const string& loginId, const string& passwordHash,
+							 const string& nickname, const RegisterCallback& done);
+
+	// 실행기에서 끝난 결과를 세션의 워커에서 반영한다
+	void OnLoginCompleted(ClientSession* session, DbResult dbResult, const UserRow& user);
+	void SendLoginBusy(ClientSession* session, uint32_t retryAfterMs);
+	void OnRegisterCompleted(ClientSession* session, DbResult dbResult);
+	void SendRegisterBusy(ClientSession* session);
 
 	ErrorCode ConvertDbResultToErrorCode(DbResult result);
 private:
 	SessionManager* mSessionManager = nullptr;
 	RoomManager* mRoomManager = nullptr;
-	DbManager* mDbManager = nullptr;
+	UserStore* mUserStore = nullptr;
+	TaskExecutor* mDbExecutor = nullptr;
+	TaskExecutor* mCryptoExecutor = nullptr;	// 비밀번호 해시/검증 전용
+	AdmissionQueue* mAuthAdmission = nullptr;	// 동시에 DB/해시로 넘어가는 로그인과 가입 수를 함께 묶는다
+	ChatLog* mChatLog = nullptr;		// nullptr이면 채팅을 기록하지 않는다
+	bool mRegisterBatching = true;		// false면 가입마다 실행기에서 INSERT 하나 (비교 측정용)
+	uint16_t mMaxRoomUserCount = ROOM_MAX_USER_LIMIT;	// 방 생성 요청의 maxUser 상한
 };
 
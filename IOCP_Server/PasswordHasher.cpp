@@ -0,0 +1,137 @@
+#include "PasswordHasher.h"
+#include <Windows.h>
+#include <bcrypt.h>
+#include <iostream>
+#include <vector>
+#pragma comment(lib, "bcrypt")
+
+static const char* HASH_PREFIX = "pbkdf2-sha256";
+
+// HMAC-SHA256 알고리즘 핸들은 상태가 없어 여러 스레드에서 함께 쓴다. 처음 쓸 때 한 번 연다
+static BCRYPT_ALG_HANDLE GetHmacSha256()
+{
+	static BCRYPT_ALG_HANDLE handle = []() -> BCRYPT_ALG_HANDLE
+	{
+		BCRYPT_ALG_HANDLE opened = nullptr;
+		NTSTATUS status = BCryptOpenAlgorithmProvider(&opened, BCRYPT_SHA256_ALGORITHM, nullptr, BCRYPT_ALG_HANDLE_HMAC_FLAG);
+		if (!BCRYPT_SUCCESS(status))
+		{
+			cout << "[PasswordHasher] BCryptOpenAlgorithmProvider failed: " << hex << status << dec << endl;
+			return nullptr;
+		}
+		return opened;
+	}();
+
+	return handle;
+}
+
+static string ToHex(const unsigned char* data, size_t length)
+{
+	static const char* digits = "0123456789abcdef";
+
+	string hex;
+	hex.reserve(length * 2);
+	for (size_t i = 0; i < length; i++)
+	{
+		hex.push_back(digits[data[i] >> 4]);
+		hex.push_back(digits[data[i] & 0x0F]);
+	}
+	return hex;
+}
+
+static bool FromHex(const string& hex, vector<unsigned char>& out)
+{
+	if (hex.size() % 2 != 0)
+		return false;
+
+	auto value = [](char c) -> int
+	{
+		if (c >= '0' && c <= '9') return c - '0';
+		if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+		return -1;
+	};
+
+	out.resize(hex.size() / 2);
+	for (size_t i = 0; i < out.size(); i++)
+	{
+		int high = value(hex[i * 2]);
+		int low = value(hex[i * 2 + 1]);
+		if (high < 0 || low < 0)
+			return false;
+
+		out[i] = static_cast<unsigned char>((high << 4) | low);
+	}
+	return true;
+}
+
+bool PasswordHasher::DeriveKey(const string& password, const unsigned char* salt, size_t saltLength,
+							   unsigned long long iterations, unsigned char* key, size_t keyLength)
+{
+	BCRYPT_ALG_HANDLE algorithm = GetHmacSha256();
+	if (algorithm == nullptr)
+		return false;
+
+	NTSTATUS status = BCryptDeriveKeyPBKDF2(algorithm,
+		(PUCHAR)password.data(), (ULONG)password.size(),
+		(PUCHAR)salt, (ULONG)saltLength,
+		iterations,
+		key, (ULONG)keyLength,
+		0);
+
+	if (!BCRYPT_SUCCESS(status))
+	{
+		cout << "[PasswordHasher] BCryptDeriveKeyPBKDF2 failed: " << hex << status << dec << endl;
+		return false;
+	}
+
+	return true;
+}
+
+string PasswordHasher::Hash(const string& password)
+{
+	unsigned char salt[PASSWORD_SALT_BYTES];
+	if (!BCRYPT_SUCCESS(BCryptGenRandom(nullptr, salt, sizeof(salt), BCRYPT_USE_SYSTEM_PREFERRED_RNG)))
+	{
+		cout << "[PasswordHasher] BCryptGenRandom failed" << endl;
+		return string();
+	}
+
+	unsigned char key[PASSWORD_KEY_BYTES];
+	if (!DeriveKey(password, salt, sizeof(salt), PASSWORD_HASH_ITERATIONS, key, sizeof(key)))
+		return string();
+
+	return string(HASH_PREFIX) + "$" + to_string(PASSWORD_HASH_ITERATIONS)
+		+ "$" + ToHex(salt, sizeof(salt)) + "$" + ToHex(key, sizeof(key));
+}
+
+bool PasswordHasher::Verify(const string& password, const string& stored)
+{
+	// prefix$iterations$salt$key
+	size_t first = stored.find('$');
+	size_t second = (first == string::npos) ? string::npos : stored.find('$', first + 1);
+	size_t third = (second == string::npos) ? string::npos : stored.find('$', second + 1);
+	if (third == string::npos || stored.compare(0, first, HASH_PREFIX) != 0)
+		return false;
+
+	unsigned long long iterations = strtoull(stored.c_str() + first + 1, nullptr, 10);
+	vector<unsigned char> salt;
+	vector<unsigned char> expected;
+	if (iterations == 0
+		|| !FromHex(stored.substr(second + 1, third - second - 1), salt)
+		|| !FromHex(stored.substr(third + 1), expected)
+		|| expected.empty())
+	{
+		return false;
+	}
+
+	vector<unsigned char> key(expected.size());
+	if (!DeriveKey(password, salt.data(), salt.size(), iterations, key.data(), key.size()))
+		return false;
+
+	// 어디서 달라졌는지 시간으로 드러나지 않게 끝까지 비교한다
+	unsigned char diff = 0;
+	for (size_t i = 0; i < key.size(); i++)
+		diff |= key[i] ^ expected[i];
+
+	return diff == 0;
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <string>
+
+// PBKDF2 반복 횟수. 한 번 검증에 코어 하나로 100ms 안팎이 되도록 잰 값이다 (BENCHMARKS.md user-048).
+// 저장 문자열에 같이 적으므로 바꿔도 예전 해시는 그대로 검증된다
+#define PASSWORD_HASH_ITERATIONS 200000
+#define PASSWORD_SALT_BYTES 16
+#define PASSWORD_KEY_BYTES 32
+
+using namespace std;
+
+// PBKDF2-HMAC-SHA256 (Windows CNG). 일부러 느리게 만든 연산이라 I/O 워커가 아닌 암호 실행기에서만 부른다.
+// 저장 형식: pbkdf2-sha256$<반복 횟수>$<salt hex>$<key hex>
+class PasswordHasher
+{
+public:
+	// 새 salt로 만든 저장 문자열. 실패하면 빈 문자열
+	static string Hash(const string& password);
+
+	// 저장 문자열과 같은 salt, 반복 횟수로 다시 계산해 비교한다
+	static bool Verify(const string& password, const string& stored);
+
+private:
+	static bool DeriveKey(const string& password, const unsigned char* salt, size_t saltLength,
+						  unsigned long long iterations, unsigned char* key, size_t keyLength);
+};
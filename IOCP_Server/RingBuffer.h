@@ -1,36 +1,35 @@
 #pragma once
 #include <vector>
 #include <algorithm>
+#include "BufferPool.h"
 
 using namespace std;
 
+// 저장 공간은 BufferPool에서 처음 쓸 때 빌려오고, 비었을 때 Release()로 돌려준다.
 class RingBuffer
 {
 
 public:
 	RingBuffer(const RingBuffer&) = delete;  
 	RingBuffer& operator=(const RingBuffer&) = delete;
+	RingBuffer(RingBuffer&&) = delete;
+	RingBuffer& operator=(RingBuffer&&) = delete;
 
-	RingBuffer()
-		: buffer(8192)
+	explicit RingBuffer(BufferPool& pool)
+		: pool(pool)
+		, buffer(nullptr)
+		, capacity(pool.GetBlockSize())
 		, head(0)
 		, tail(0)
 		, dataSize(0)
 	{
 	}
 
-	RingBuffer(size_t cap)
-		: buffer(cap)
-		, head(0)
-		, tail(0)
-		, dataSize(0)
+	~RingBuffer()
 	{
+		pool.Release(buffer);
 	}
 
-	RingBuffer(RingBuffer&&) noexcept = default;
-	RingBuffer& operator=(RingBuffer&&) noexcept = default;
-	~RingBuffer() = default;
-
 	bool Write(const char* data, size_t len)
 	{
 		if (GetFreeSize() < len)
@@ -38,15 +37,15 @@ public:
 			return false;
 		}
 
-		size_t capacity = buffer.size();
+		Acquire();
 
 		size_t firstPart = min(len, capacity - head);
 
-		memcpy(buffer.data() + head, data, firstPart);
+		memcpy(buffer + head, data, firstPart);
 
 		if (len > firstPart)
 		{
-			memcpy(buffer.data(), data + firstPart, len - firstPart);
+			memcpy(buffer, data + firstPart, len - firstPart);
 		}
 
 		head = (head + len) % capacity;
@@ -54,6 +53,35 @@ public:
 		return true;
 	}
 
+	// 빈 공간을 최대 두 구간으로 돌려준다. 소켓이 직접 채운 뒤 CommitWrite()로 확정한다.
+	bool GetWritableSpans(char*& first, size_t& firstLen, char*& second, size_t& secondLen)
+	{
+		size_t freeSize = GetFreeSize();
+		if (freeSize == 0)
+		{
+			return false;
+		}
+
+		Acquire();
+
+		first = buffer + head;
+		firstLen = min(freeSize, capacity - head);
+		second = buffer;
+		secondLen = freeSize - firstLen;
+		return true;
+	}
+
+	void CommitWrite(size_t len)
+	{
+		if (len > GetFreeSize())
+		{
+			len = GetFreeSize();
+		}
+
+		head = (head + len) % capacity;
+		dataSize += len;
+	}
+
 	bool Peek(char* outBuffer, size_t len)
 	{
 		if (dataSize < len)
@@ -61,14 +89,13 @@ public:
 			return false;
 		}
 
-		size_t capacity = buffer.size();
 		size_t firstPart = min(len, capacity - tail);
 
-		memcpy(outBuffer, buffer.data() + tail, firstPart);
+		memcpy(outBuffer, buffer + tail, firstPart);
 
 		if (len > firstPart)
 		{
-			memcpy(outBuffer + firstPart, buffer.data(), len - firstPart);
+			memcpy(outBuffer + firstPart, buffer, len - firstPart);
 		}
 
 		return true;
@@ -81,18 +108,39 @@ public:
 			len = dataSize;
 		}
 
-		tail = (tail + len) % buffer.size();
+		tail = (tail + len) % capacity;
 		dataSize -= len;
 	}
 
-	size_t GetFreeSize() const { return buffer.size() - dataSize; }
+	void Release()
+	{
+		pool.Release(buffer);
+		buffer = nullptr;
+		head = 0;
+		tail = 0;
+		dataSize = 0;
+	}
+
+	size_t GetFreeSize() const { return capacity - dataSize; }
 	size_t GetDataSize() const { return dataSize; }
 	bool IsEmpty() const { return dataSize == 0; }
-	bool IsFull() const { return buffer.size() == dataSize; }
+	bool IsFull() const { return capacity == dataSize; }
+	bool IsLeased() const { return buffer != nullptr; }
+
+private:
+	void Acquire()
+	{
+		if (buffer == nullptr)
+		{
+			buffer = pool.Acquire();
+		}
+	}
 
 private:
-	vector<char> buffer;
+	BufferPool& pool;
+	char* buffer;
+	size_t capacity;
 	size_t head;
 	size_t tail;
 	size_t dataSize;
-};
\ No newline at end of file
+};
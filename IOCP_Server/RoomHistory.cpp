@@ -0,0 +1,118 @@
+#include "RoomHistory.h"
+#include "../Common/Packet.h"
+
+RoomHistory::RoomHistory(BufferPool* pool)
+	: mPool(pool)
+	, mBlock(nullptr)
+	, mHead(0)
+	, mUsed(0)
+	, mCount(0)
+{
+}
+
+RoomHistory::~RoomHistory()
+{
+	Clear();
+}
+
+void RoomHistory::Append(string_view name, string_view message)
+{
+	if (mPool == nullptr)
+		return;
+
+	const size_t capacity = mPool->GetBlockSize();
+
+	name = name.substr(0, min(name.size(), static_cast<size_t>(MAX_USER_NAME)));
+
+	// 레코드 하나가 블록보다 크면 메시지를 잘라 넣는다
+	size_t fixedSize = sizeof(uint8_t) + name.size() + sizeof(uint16_t);
+	if (fixedSize >= capacity)
+		return;
+
+	message = message.substr(0, min(message.size(), capacity - fixedSize));
+	size_t recordSize = fixedSize + message.size();
+
+	if (mBlock == nullptr)
+		mBlock = mPool->Acquire();
+
+	while (mUsed + recordSize > capacity)
+	{
+		size_t oldest = GetRecordSize(mHead);
+		mHead = (mHead + oldest) % capacity;
+		mUsed -= oldest;
+		mCount--;
+	}
+
+	size_t tail = (mHead + mUsed) % capacity;
+
+	uint8_t nameLen = static_cast<uint8_t>(name.size());
+	uint16_t messageLen = static_cast<uint16_t>(message.size());
+
+	Write(tail, &nameLen, sizeof(nameLen));
+	Write(tail + sizeof(nameLen), name.data(), name.size());
+	Write(tail + sizeof(nameLen) + name.size(), &messageLen, sizeof(messageLen));
+	Write(tail + fixedSize, message.data(), message.size());
+
+	mUsed += recordSize;
+	mCount++;
+}
+
+SendBufferPtr RoomHistory::BuildNotiPacket() const
+{
+	if (mCount == 0)
+		return nullptr;
+
+	RoomHistoryNotiPacket header;
+	header.messageCount = mCount;
+	header.SetSize(static_cast<uint16_t>(sizeof(RoomHistoryNotiPacket) + mUsed));
+
+	auto buffer = make_shared<vector<char>>(sizeof(RoomHistoryNotiPacket) + mUsed);
+	memcpy(buffer->data(), &header, sizeof(header));
+	Read(mHead, buffer->data() + sizeof(header), mUsed);
+
+	return buffer;
+}
+
+void RoomHistory::Clear()
+{
+	if (mBlock != nullptr)
+	{
+		mPool->Release(mBlock);
+		mBlock = nullptr;
+	}
+
+	mHead = 0;
+	mUsed = 0;
+	mCount = 0;
+}
+
+void RoomHistory::Write(size_t pos, const void* src, size_t len)
+{
+	const size_t capacity = mPool->GetBlockSize();
+	pos %= capacity;
+
+	size_t first = min(len, capacity - pos);
+	memcpy(mBlock + pos, src, first);
+	memcpy(mBlock, static_cast<const char*>(src) + first, len - first);
+}
+
+void RoomHistory::Read(size_t pos, void* dst, size_t len) const
+{
+	const size_t capacity = mPool->GetBlockSize();
+	pos %= capacity;
+
+	size_t first = min(len, capacity - pos);
+	memcpy(dst, mBlock + pos, first);
+	memcpy(static_cast<char*>(dst) + first, mBlock, len - first);
+}
+
+size_t RoomHistory::GetRecordSize(size_t pos) const
+{
+	uint8_t nameLen = 0;
+	uint16_t messageLen = 0;
+
+	Read(pos, &nameLen, sizeof(nameLen));
+	Read(pos + sizeof(nameLen) + nameLen, &messageLen, sizeof(messageLen));
+
+	return sizeof(nameLen) + nameLen + sizeof(messageLen) + messageLen;
+}
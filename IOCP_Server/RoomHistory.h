@@ -0,0 +1,46 @@
+#pragma once
+#include <Windows.h>
+#include <string_view>
+#include "BufferPool.h"
+#include "ClientSession.h"
+
+#define ROOM_HISTORY_BYTES 4096			// 방 하나가 기록에 쓰는 최대 바이트 (0이면 기록하지 않음)
+#define ROOM_HISTORY_BLOCKS_PER_SLAB 64
+
+using namespace std;
+
+// 방의 최근 채팅을 고정 크기 블록 하나에 바이트 링으로 담는다.
+// 레코드는 RoomHistoryNotiPacket 본문과 같은 형식이라 입장 시 그대로 복사해 보낸다.
+//   [uint8 nameLen][name][uint16 messageLen][message]
+// 블록이 차면 가장 오래된 레코드부터 밀어낸다. 방 실행 워커만 접근한다.
+class RoomHistory
+{
+public:
+	explicit RoomHistory(BufferPool* pool);
+	~RoomHistory();
+
+	RoomHistory(const RoomHistory&) = delete;
+	RoomHistory& operator=(const RoomHistory&) = delete;
+
+	void Append(string_view name, string_view message);
+
+	// 오래된 순서의 RoomHistoryNotiPacket 한 개. 기록이 없으면 nullptr
+	SendBufferPtr BuildNotiPacket() const;
+
+	// 블록을 풀에 반납한다
+	void Clear();
+
+	uint16_t GetCount() const { return mCount; }
+
+private:
+	void Write(size_t pos, const void* src, size_t len);
+	void Read(size_t pos, void* dst, size_t len) const;
+	size_t GetRecordSize(size_t pos) const;
+
+private:
+	BufferPool* const mPool;
+	char* mBlock;			// 첫 기록 때 빌린다
+	size_t mHead;			// 가장 오래된 레코드 위치
+	size_t mUsed;
+	uint16_t mCount;
+};
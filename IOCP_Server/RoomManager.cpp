@@ -1,24 +1,73 @@
 #include "RoomManager.h"
 
-RoomManager::RoomManager(uint32_t maxRoomCount) : mActiveRoomCount(0)
+RoomManager::RoomManager(uint32_t maxRoomCount, size_t historyBytes)
+	: mMaxRoomCount(maxRoomCount)
+	, mIOCPHandle(nullptr)
+	, mActiveRoomCount(0)
+	, mPageCacheVersion(0)
 {
+	// 기록은 패킷 하나로 보내므로 size 필드(uint16) 범위를 넘지 않게 자른다
+	historyBytes = min(historyBytes, static_cast<size_t>(UINT16_MAX) - sizeof(RoomHistoryNotiPacket));
+	if (historyBytes > 0)
+		mHistoryPool = std::make_unique<BufferPool>(historyBytes, ROOM_HISTORY_BLOCKS_PER_SLAB);
+
 	InitializeSRWLock(&mSrwLock);
+	InitializeSRWLock(&mPageCacheLock);
+	InitializeSRWLock(&mMatchLock);
+
+	SRWLockGuard lock(&mSrwLock);
+	AddRoomChunk();
+}
+
+bool RoomManager::AddRoomChunk()
+{
+	uint32_t firstId = static_cast<uint32_t>(mRoomContainer.size());
+	if (firstId >= mMaxRoomCount)
+		return false;
+
+	uint32_t count = min(static_cast<uint32_t>(ROOM_CHUNK_SIZE), mMaxRoomCount - firstId);
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		mRoomContainer.emplace_back(std::make_unique<RoomSession>(firstId + i, this));
+	}
+
+	// 낮은 id부터 꺼내 쓰도록 역순으로 쌓는다
+	for (uint32_t i = count; i > 0; --i)
+	{
+		mRoomIndexes.push(firstId + i - 1);
+	}
+
+	return true;
+}
+
+void RoomManager::Reserve(uint32_t count)
+{
+	SRWLockGuard lock(&mSrwLock);
 
-	mRoomContainer.reserve(maxRoomCount);
-	for (uint32_t i = 0; i < maxRoomCount; ++i)
+	while (mRoomContainer.size() < count)
 	{
-		mRoomContainer.emplace_back(std::make_unique<RoomSession>(i));
-		mRoomIndexes.push(i);
+		if (!AddRoomChunk())
+			break;
 	}
 }
 
+size_t RoomManager::GetReservedRoomCount()
+{
+	SRWLockGuard lock(&mSrwLock, false);
+	return mRoomContainer.size();
+}
+
 RoomSession* RoomManager::GetEmptyRoom()
 {
 	RoomSession* room = nullptr;
 
+	if (mRoomIndexes.empty())
+		AddRoomChunk();
+
 	if (!mRoomIndexes.empty())
 	{
-		int idx = mRoomIndexes.top();
+		uint32_t idx = mRoomIndexes.top();
 		mRoomIndexes.pop();
 
 		room = mRoomContainer[idx].get();
@@ -27,75 +76,152 @@ RoomSession* RoomManager::GetEmptyRoom()
 	return room;
 }
 
-RoomSession* RoomManager::FindRoomById(uint16_t roomId)
+RoomSession* RoomManager::FindRoomById(uint32_t roomId)
 {
-	auto it = mRoomById.find(roomId);
-	RoomSession* result = (it != mRoomById.end()) ? it->second : nullptr;
+	auto it = mRoomDirectory.find(roomId);
+	RoomSession* result = (it != mRoomDirectory.end()) ? it->second : nullptr;
 
 	return result;
 }
 
-std::optional<RoomInfo> RoomManager::CreateRoomSession(ClientSession* session, std::string_view roomName, uint16_t maxUserCount)
+// 입장 작업은 패킷을 처리 중인(I/O 참조를 가진) 워커가 만들므로 여기서 이름을 안전하게 복사해 둔다
+static RoomJob MakeEnterJob(RoomJobType type, ClientSession* session)
 {
-	SRWLockGuard lock(&mSrwLock);
+	RoomJob job{ type, session, session->GetSessionId() };
+	memcpy(job.nickname, session->GetUsernameBlob(), sizeof(job.nickname));
+	return job;
+}
+
+ErrorCode RoomManager::CreateRoomSession(ClientSession* session, std::string_view roomName, uint16_t maxUserCount)
+{
+	if (session->GetUserState() != UserState::LOBBY)
+		return ErrorCode::ALREADY_IN_ROOM;
 
-	RoomSession* room = GetEmptyRoom();
-	if (room == nullptr) return std::nullopt;
+	RoomSession* room = nullptr;
+	{
+		SRWLockGuard lock(&mSrwLock);
 
-	room->Init(maxUserCount);
-	room->SetRoomName(string(roomName));
-	room->JoinUser(session);
+		room = GetEmptyRoom();
+		if (room == nullptr)
+			return ErrorCode::ROOM_CREATION_FAIL;
 
-	mRoomById[room->GetRoomId()] = room;
-	mActiveRoomCount++;
+		room->Prepare(string(roomName), maxUserCount);
+		mActiveRoomCount++;
+	}
 
-	return RoomInfo{ room->GetRoomId(), room->GetRoomName(), maxUserCount, 1 };
+	// 방장 입장과 응답은 방 작업 큐에서 처리하고, 입장이 끝나면 방이 PublishRoom으로 목록에 올린다
+	room->PushJob(MakeEnterJob(RoomJobType::OPEN, session));
+	return ErrorCode::SUCCESS;
 }
 
-std::optional<vector<RoomInfo>> RoomManager::GetRoomListByPage(uint16_t page)
+SendBufferPtr RoomManager::BuildRoomListPage(uint32_t cursor, uint32_t& lastRoomId) const
 {
-	SRWLockGuard lock(&mSrwLock, false);
+	RoomListResPacket resPacket;
+	resPacket.result = ErrorCode::SUCCESS;
+
+	auto it = mRoomDirectory.lower_bound(cursor);
+	for (; it != mRoomDirectory.end() && resPacket.roomCount < MAX_ROOM_PAGE_COUNT; ++it)
+	{
+		RoomSession* room = it->second;
+		resPacket.rooms[resPacket.roomCount++] = RoomInfo{ room->GetRoomId(),
+														   room->GetRoomName(),
+														   room->GetMaxUserCount(),
+														   room->GetCurrentUserCount() };
+	}
+
+	// 뒤에 방이 더 있을 때만 다음 커서를 준다
+	if (it != mRoomDirectory.end())
+	{
+		lastRoomId = resPacket.rooms[resPacket.roomCount - 1].roomId;
+		resPacket.nextCursor = lastRoomId + 1;
+	}
+	else
+	{
+		lastRoomId = INVALID_ROOM_ID;
+	}
 
-	vector<RoomInfo> list;
-	list.reserve(MAX_ROOM_PAGE_COUNT);
+	return MakeSendBuffer((char*)&resPacket, sizeof(resPacket));
+}
 
-	if (mRoomById.empty())
-		return list;
+SendBufferPtr RoomManager::GetRoomListPage(uint32_t cursor)
+{
+	// 디렉터리 구조 변경(삽입/삭제)은 막고, 인원 변경은 version으로 걸러낸다
+	SRWLockGuard lock(&mSrwLock, false);
+
+	uint64_t version = 0;
+	{
+		SRWLockGuard cacheLock(&mPageCacheLock, false);
 
-	uint16_t totalPage = static_cast<uint16_t>(mRoomById.size() / MAX_ROOM_PAGE_COUNT);
-	if (mRoomById.size() % MAX_ROOM_PAGE_COUNT != 0)
-		totalPage++;
+		auto it = mPageCache.find(cursor);
+		if (it != mPageCache.end())
+			return it->second.payload;
 
-	if (page >= totalPage)
-		return std::nullopt;
+		version = mPageCacheVersion;
+	}
 
-	uint16_t startIdx = page * MAX_ROOM_PAGE_COUNT;
-	uint16_t idx = 0;
+	uint32_t lastRoomId = INVALID_ROOM_ID;
+	SendBufferPtr payload = BuildRoomListPage(cursor, lastRoomId);
 
-	for (auto& [_, room] : mRoomById)
 	{
-		if (idx < startIdx) { idx++; continue; }
-		if (idx >= startIdx + MAX_ROOM_PAGE_COUNT) break;
-
-		list.push_back(RoomInfo{ room->GetRoomId(),
-								 room->GetRoomName(),
-								 room->GetMaxUserCount(),
-								 room->GetCurrentUserCount() });
-		idx++;
+		SRWLockGuard cacheLock(&mPageCacheLock);
+		if (mPageCacheVersion == version && mPageCache.size() < ROOM_LIST_CACHE_LIMIT)
+			mPageCache[cursor] = { payload, lastRoomId };
 	}
-	return list;
+
+	return payload;
 }
 
-std::pair<ErrorCode, RoomSession*> RoomManager::JoinRoom(ClientSession* session, uint16_t roomId)
+RoomSession* RoomManager::FindRoom(uint32_t roomId)
 {
-	SRWLockGuard lock(&mSrwLock);
-	auto room = FindRoomById(roomId);
+	SRWLockGuard lock(&mSrwLock, false);
+	return FindRoomById(roomId);
+}
+
+ErrorCode RoomManager::JoinRoom(ClientSession* session, uint32_t roomId)
+{
+	if (session->GetUserState() != UserState::LOBBY)
+		return ErrorCode::ALREADY_IN_ROOM;
+
+	auto room = FindRoom(roomId);
 	if (room == nullptr)
-		return { ErrorCode::ROOM_NOT_FOUND, nullptr };
+		return ErrorCode::ROOM_NOT_FOUND;
 
-	ErrorCode result = room->JoinUser(session);
+	room->PushJob(MakeEnterJob(RoomJobType::JOIN, session));
+	return ErrorCode::SUCCESS;
+}
+
+ErrorCode RoomManager::QuickJoin(ClientSession* session)
+{
+	return QuickJoin(MakeEnterJob(RoomJobType::QUICK_JOIN, session), nullptr);
+}
+
+ErrorCode RoomManager::QuickJoin(const RoomJob& job, RoomSession* exclude)
+{
+	if (job.session->GetUserState() != UserState::LOBBY)
+		return ErrorCode::ALREADY_IN_ROOM;
+
+	RoomSession* room = nullptr;
+	{
+		SRWLockGuard lock(&mSrwLock, false);
+		SRWLockGuard matchLock(&mMatchLock);
+
+		auto it = mOpenRooms.begin();
+		if (it != mOpenRooms.end() && exclude != nullptr && it->second == exclude->GetRoomId())
+			++it;
+
+		if (it == mOpenRooms.end())
+			return ErrorCode::NO_AVAILABLE_ROOM;
 
-	return { result, result == ErrorCode::SUCCESS ? room : nullptr };
+		room = mRoomContainer[it->second].get();
+
+		// 방이 입장을 처리하기 전까지 한 자리를 잡아 둬 동시에 들어온 요청이 마지막 자리로 몰리지 않게 한다.
+		// 잡은 자리는 인원과 따로 세므로 그 사이 다른 입장/퇴장의 OnRoomUpdated가 덮어쓰지 못한다.
+		room->SetSeatHolds(room->GetSeatHolds() + 1);
+		UpdateMatchIndex(room);
+	}
+
+	room->PushJob(RoomJob(job));
+	return ErrorCode::SUCCESS;
 }
 
 ErrorCode RoomManager::LeaveRoom(ClientSession* session)
@@ -103,45 +229,185 @@ ErrorCode RoomManager::LeaveRoom(ClientSession* session)
 	if (session->GetUserState() != UserState::IN_ROOM)
 		return ErrorCode::INVALID_STATE;
 
-	SRWLockGuard lock(&mSrwLock);
-
-	auto room = FindRoomById(session->GetRoomId());
+	auto room = FindRoom(session->GetRoomId());
 	if (room == nullptr)
 		return ErrorCode::ROOM_NOT_FOUND;
 
-	room->LeaveUser(session);
+	// 마지막 인원이 나가면 방이 스스로 RemoveRoomSession을 호출한다
+	room->PushJob({ RoomJobType::LEAVE, session, session->GetSessionId() });
+	return ErrorCode::SUCCESS;
+}
 
-	if (room->IsEmpty())
-		RemoveRoomSession(room);
+ErrorCode RoomManager::RequestUserList(ClientSession* session)
+{
+	if (session->GetUserState() != UserState::IN_ROOM)
+		return ErrorCode::INVALID_STATE;
 
+	auto room = FindRoom(session->GetRoomId());
+	if (room == nullptr)
+		return ErrorCode::ROOM_NOT_FOUND;
+
+	room->PushJob({ RoomJobType::LIST_USER, session, session->GetSessionId() });
 	return ErrorCode::SUCCESS;
 }
 
+void RoomManager::PublishRoom(RoomSession* room)
+{
+	SRWLockGuard lock(&mSrwLock);
+
+	mRoomDirectory.emplace(room->GetRoomId(), room);
+	AddNameIndex(room);
+	InvalidatePages(room->GetRoomId());
+
+	SRWLockGuard matchLock(&mMatchLock);
+	UpdateMatchIndex(room);
+}
+
 void RoomManager::RemoveRoomSession(RoomSession* room)
 {
-	mRoomById.erase(room->GetRoomId());
-	room->Clear();
+	SRWLockGuard lock(&mSrwLock);
+
+	// OPEN이 실패한 방은 목록에 오른 적이 없다
+	if (mRoomDirectory.erase(room->GetRoomId()) != 0)
+	{
+		InvalidatePages(room->GetRoomId());
+		RemoveNameIndex(room);
+	}
+
+	{
+		SRWLockGuard matchLock(&mMatchLock);
+		if (room->GetMatchFreeSeats() != 0)
+			mOpenRooms.erase({ room->GetMatchFreeSeats(), room->GetRoomId() });
+		room->SetMatchFreeSeats(0);
+	}
 
 	mRoomIndexes.push(room->GetRoomId());
 
 	mActiveRoomCount--;
 }
 
+void RoomManager::OnRoomUpdated(RoomSession* room)
+{
+	SRWLockGuard lock(&mSrwLock, false);
+
+	if (FindRoomById(room->GetRoomId()) != room)
+		return;
+
+	InvalidatePages(room->GetRoomId());
+
+	SRWLockGuard matchLock(&mMatchLock);
+	UpdateMatchIndex(room);
+}
+
+void RoomManager::ReleaseSeatHold(RoomSession* room)
+{
+	SRWLockGuard lock(&mSrwLock, false);
+	SRWLockGuard matchLock(&mMatchLock);
+
+	if (room->GetSeatHolds() != 0)
+		room->SetSeatHolds(room->GetSeatHolds() - 1);
+
+	// 닫힌 방은 잡은 자리만 풀고 색인에는 다시 올리지 않는다
+	if (FindRoomById(room->GetRoomId()) == room)
+		UpdateMatchIndex(room);
+}
+
+void RoomManager::UpdateMatchIndex(RoomSession* room)
+{
+	uint16_t maxCount = room->GetMaxUserCount();
+	uint16_t takenCount = room->GetCurrentUserCount() + room->GetSeatHolds();
+	uint16_t freeSeats = (takenCount < maxCount) ? maxCount - takenCount : 0;
+
+	uint16_t oldSeats = room->GetMatchFreeSeats();
+	if (oldSeats == freeSeats)
+		return;
+
+	if (oldSeats != 0)
+		mOpenRooms.erase({ oldSeats, room->GetRoomId() });
+
+	if (freeSeats != 0)
+		mOpenRooms.insert({ freeSeats, room->GetRoomId() });
+
+	room->SetMatchFreeSeats(freeSeats);
+}
+
+void RoomManager::AddNameIndex(RoomSession* room)
+{
+	mRoomNameIndex.insert({ room->GetRoomName(), room->GetRoomId() });
+}
+
+void RoomManager::RemoveNameIndex(RoomSession* room)
+{
+	mRoomNameIndex.erase({ room->GetRoomName(), room->GetRoomId() });
+}
+
+ErrorCode RoomManager::SearchRoomByPrefix(std::string_view prefix, uint16_t page, RoomSearchResPacket& outPacket)
+{
+	SRWLockGuard lock(&mSrwLock, false);
+
+	size_t startIdx = static_cast<size_t>(page) * MAX_ROOM_PAGE_COUNT;
+	if (startIdx >= ROOM_SEARCH_MAX_MATCHES)
+		return ErrorCode::INVALID_ROOM_REQUEST;
+
+	// 접두사와 일치하는 방은 (prefix, 0)부터 이어진다. 트리라 임의 위치로 건너뛸 수 없으므로
+	// 상한까지만 세면서 요청한 페이지를 채운다
+	size_t totalCount = 0;
+	outPacket.roomCount = 0;
+
+	for (auto it = mRoomNameIndex.lower_bound({ prefix, 0 });
+		 it != mRoomNameIndex.end() && totalCount < ROOM_SEARCH_MAX_MATCHES; ++it, ++totalCount)
+	{
+		if (it->first.substr(0, prefix.size()) != prefix)
+			break;
+
+		if (totalCount < startIdx || outPacket.roomCount >= MAX_ROOM_PAGE_COUNT)
+			continue;
+
+		RoomSession* room = mRoomContainer[it->second].get();
+		outPacket.rooms[outPacket.roomCount++] = RoomInfo{ room->GetRoomId(),
+														   room->GetRoomName(),
+														   room->GetMaxUserCount(),
+														   room->GetCurrentUserCount() };
+	}
+
+	if (startIdx >= totalCount && !(page == 0 && totalCount == 0))
+		return ErrorCode::INVALID_ROOM_REQUEST;
+
+	outPacket.totalCount = static_cast<uint32_t>(totalCount);
+	return ErrorCode::SUCCESS;
+}
+
+void RoomManager::InvalidatePages(uint32_t roomId)
+{
+	SRWLockGuard lock(&mPageCacheLock);
+
+	mPageCacheVersion++;
+
+	// roomId 이하 커서 중 가까운 것부터 뒤로. 범위가 roomId에 못 미치면 그보다 앞 페이지도 못 미친다
+	auto it = mPageCache.upper_bound(roomId);
+	while (it != mPageCache.begin())
+	{
+		--it;
+		if (it->second.lastRoomId < roomId)
+			break;
+
+		it = mPageCache.erase(it);
+	}
+}
+
 ErrorCode RoomManager::RoomChat(ClientSession* session, const char* message)
 {
 	if (session->GetUserState() != UserState::IN_ROOM)
 		return ErrorCode::INVALID_STATE;
 
-	SRWLockGuard lock(&mSrwLock);
-
-	auto room = FindRoomById(session->GetRoomId());
+	auto room = FindRoom(session->GetRoomId());
 	if (room == nullptr)
 		return ErrorCode::ROOM_NOT_FOUND;
 
 	RoomChatNotiPacket notiPacket;
-	strncpy_s(notiPacket.user, sizeof(notiPacket.user), session->GetUsername().c_str(), _TRUNCATE);
+	memcpy(notiPacket.user, session->GetUsernameBlob(), sizeof(notiPacket.user));
 	strncpy_s(notiPacket.message, sizeof(notiPacket.message), message, _TRUNCATE);
 
-	room->BroadCast((char*)&notiPacket, sizeof(notiPacket));
+	room->PushJob({ RoomJobType::CHAT, session, session->GetSessionId(), MakeSendBuffer((char*)&notiPacket, sizeof(notiPacket)) });
 	return ErrorCode::SUCCESS;
-}
\ No newline at end of file
+}
@@ -1,16 +1,24 @@
 #pragma once
 #include <vector>
 #include <stack>
+#include <set>
 #include <map>
 #include <optional>
+#include <algorithm>
 #include <memory>
 #include "RoomSession.h"
 #include "..\Common\Packet.h"
 
+#define ROOM_CHUNK_SIZE 1024
+#define ROOM_LIST_CACHE_LIMIT 4096	// 캐시해 둘 목록 페이지 수 상한 (커서마다 하나)
+#define ROOM_MAX_USER_LIMIT 50000	// 방 하나에 받을 수 있는 최대 인원 기본값 (--max-room-users로 바꾼다)
+#define ROOM_SEARCH_MAX_MATCHES 1000	// 검색 한 번에 세는 일치 방 수 상한. 넘으면 totalCount가 이 값이고 그 뒤 페이지는 없다
+
 class RoomManager
 {
 public:
-	RoomManager(uint32_t maxRoomCount);
+	// historyBytes: 방마다 최근 채팅을 담는 바이트 상한 (0이면 기록하지 않음)
+	RoomManager(uint32_t maxRoomCount, size_t historyBytes = ROOM_HISTORY_BYTES);
 	~RoomManager() = default;
 
 	RoomManager(const RoomManager&) = delete;
@@ -18,25 +26,92 @@ public:
 	RoomManager(RoomManager&&) = delete;
 	RoomManager& operator=(RoomManager&&) = delete;
 
-	std::optional<vector<RoomInfo>> GetRoomListByPage(uint16_t page);
-	std::optional<RoomInfo> CreateRoomSession(ClientSession* session, std::string_view roomName, uint16_t maxUserCount);
-	std::pair<ErrorCode, RoomSession*> JoinRoom(ClientSession* session, uint16_t roomId);
+	// cursor 이상인 방 id부터 MAX_ROOM_PAGE_COUNT개를 직렬화한 RoomListResPacket.
+	// 방이 생기거나 사라져도 다른 커서의 페이지는 밀리지 않는다
+	SendBufferPtr GetRoomListPage(uint32_t cursor);
+
+	// 이름 접두사 검색. 이름 색인에서 O(log n)으로 시작점을 찾고 ROOM_SEARCH_MAX_MATCHES개까지만 센다
+	ErrorCode SearchRoomByPrefix(std::string_view prefix, uint16_t page, RoomSearchResPacket& outPacket);
+
+	// 아래 요청은 방 작업 큐에 넣고 SUCCESS를 돌려준다. 실제 응답은 방이 보낸다.
+	ErrorCode CreateRoomSession(ClientSession* session, std::string_view roomName, uint16_t maxUserCount);
+	ErrorCode JoinRoom(ClientSession* session, uint32_t roomId);
+	// 빈자리가 있는 방 중 가장 많이 찬 방으로 입장. 매칭 색인에서 O(log n)
+	ErrorCode QuickJoin(ClientSession* session);
+	// 고른 방이 처리 전에 찼거나 닫혔을 때 그 방의 워커가 부른다. exclude를 빼고 같은 작업(복사해 둔 이름 포함)을 다시 넣는다
+	ErrorCode QuickJoin(const RoomJob& job, RoomSession* exclude);
 	ErrorCode LeaveRoom(ClientSession* session);
 	ErrorCode RoomChat(ClientSession* session, const char* message);
+	ErrorCode RequestUserList(ClientSession* session);
+
+	// 방 풀을 count개까지 미리 확장한다 (벤치마크/예열용)
+	void Reserve(uint32_t count);
+	size_t GetReservedRoomCount();
+
+	// 방 작업 큐의 남은 작업을 이어 처리할 완료 포트. 없으면 방이 끝까지 직접 처리한다 (벤치마크)
+	void SetCompletionPort(HANDLE iocpHandle) { mIOCPHandle = iocpHandle; }
+	HANDLE GetCompletionPort() const { return mIOCPHandle; }
+
+	// RoomSession 실행 워커가 호출. 방은 OPEN으로 방장이 들어간 뒤에야 목록/검색/입장 대상이 된다
+	void PublishRoom(RoomSession* room);
+	void RemoveRoomSession(RoomSession* room);
+	void OnRoomUpdated(RoomSession* room);
+	// QUICK_JOIN 작업을 처리한 방이 호출. QuickJoin이 잡아 둔 자리 하나를 푼다
+	void ReleaseSeatHold(RoomSession* room);
+	BufferPool* GetHistoryPool() { return mHistoryPool.get(); }
 	
 private:
-	RoomSession* FindRoomById(uint16_t roomId);
-	void RemoveRoomSession(RoomSession* room);
+	RoomSession* FindRoom(uint32_t roomId);
+	RoomSession* FindRoomById(uint32_t roomId);
 	RoomSession* GetEmptyRoom();
+	bool AddRoomChunk();
+
+	SendBufferPtr BuildRoomListPage(uint32_t cursor, uint32_t& lastRoomId) const;
+	// roomId를 담고 있는 캐시 페이지만 버린다
+	void InvalidatePages(uint32_t roomId);
+
+	void AddNameIndex(RoomSession* room);
+	void RemoveNameIndex(RoomSession* room);
+
+	// mMatchLock 안에서 호출. 인원과 잡아 둔 자리를 뺀 빈자리로 색인을 맞추고 0이면 뺀다
+	void UpdateMatchIndex(RoomSession* room);
 
 private:
-	vector<std::unique_ptr<RoomSession>> mRoomContainer;
-	stack<int> mRoomIndexes;
+	uint32_t mMaxRoomCount;
+	HANDLE mIOCPHandle;
+	std::unique_ptr<BufferPool> mHistoryPool;	// 방 기록 블록 (방이 닫히면 반납)
+	vector<std::unique_ptr<RoomSession>> mRoomContainer;	// 인덱스 == 방 id, ROOM_CHUNK_SIZE씩 늘어난다
+	stack<uint32_t> mRoomIndexes;
+
+	// OPEN이 끝난 방을 id 순으로. 목록은 커서(id) 위치부터 훑으므로 삽입/삭제가 다른 페이지를 밀지 않는다
+	map<uint32_t, RoomSession*> mRoomDirectory;
 
-	map<uint16_t, RoomSession*> mRoomById;
+	// (이름, id) 순의 검색 색인. 같은 접두사를 가진 방은 연속 구간이 된다.
+	// 생성/종료가 디렉터리 락 안에서 O(log n)이 되도록 트리로 둔다.
+	// 이름은 방의 mName을 가리킨다 (색인에 있는 동안 바뀌지 않는다).
+	set<pair<std::string_view, uint32_t>> mRoomNameIndex;
 
 	int mActiveRoomCount;
 
+	// 방 디렉터리(mRoomDirectory, mRoomNameIndex, mRoomIndexes)만 보호한다. 방 내부는 RoomSession 작업 큐.
 	SRWLOCK mSrwLock;
+
+	// 커서별 직렬화 결과. 유효한 페이지끼리는 커서가 클수록 lastRoomId도 크거나 같으므로
+	// 방 하나가 바뀌면 그 id 이하 커서에서 뒤로 훑다가 범위를 벗어나는 첫 페이지에서 멈춘다.
+	// version은 빌드 도중 무효화된 결과를 저장하지 않기 위해 쓴다.
+	struct RoomListPageCache
+	{
+		SendBufferPtr payload;
+		uint32_t lastRoomId;	// 페이지에 담긴 마지막 방 id. 끝까지 담았으면 INVALID_ROOM_ID
+	};
+
+	map<uint32_t, RoomListPageCache> mPageCache;	// mPageCacheLock
+	uint64_t mPageCacheVersion;						// mPageCacheLock
+	SRWLOCK mPageCacheLock;
+
+	// 빈자리가 있는 방의 매칭 색인. (빈자리 수, id) 순이라 begin()이 가장 많이 찬 방이다.
+	// 락 순서는 디렉터리 락 -> 매칭 락.
+	set<pair<uint16_t, uint32_t>> mOpenRooms;	// mMatchLock
+	SRWLOCK mMatchLock;
 };
 
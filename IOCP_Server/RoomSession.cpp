@@ -1,118 +1,554 @@
 #include "RoomSession.h"
+#include "RoomManager.h"
+#include <iostream>
 
-RoomSession::RoomSession(uint16_t roomId)
-	: mMaxUserCount(2)
-	, mRoomId(roomId)
+RoomSession::RoomSession(uint32_t roomId, RoomManager* owner)
+	: mRoomId(roomId)
+	, mOwner(owner)
 	, mCurPage(0)
+	, mMaxUserCount(2)
+	, mMatchFreeSeats(0)
+	, mSeatHolds(0)
+	, mProcessedCount(0)
+	, mHistory(owner->GetHistoryPool())
+	, mFanoutDirty(true)
+	, mFanoutDeadSeen(false)
+	, mUserCount(0)
 	, mRoomState(RoomState::IDLE)
+	, mIsExecuting(false)
 {
-	mUsers.reserve(mMaxUserCount);
+	InitializeSRWLock(&mJobLock);
+
+	ZeroMemory(&mExecuteOverlappedEx, sizeof(OverlappedEx));
+	mExecuteOverlappedEx.operation = IOOperation::ROOM_EXECUTE;
 }
 
-void RoomSession::Init(uint16_t maxUserCount)
+void RoomSession::Prepare(const string& name, uint16_t maxUserCount)
 {
+	mName = name;
 	mMaxUserCount = maxUserCount;
-	mUsers.reserve(maxUserCount);
-	mRoomState = RoomState::ACTIVE;
 }
 
-void RoomSession::Clear()
+void RoomSession::PushJob(RoomJob&& job)
 {
-	mMaxUserCount = 2;
-	mUsers.clear();
-	mRoomState = RoomState::IDLE;
+	{
+		SRWLockGuard lock(&mJobLock);
+		mPendingJobs.push_back(std::move(job));
+
+		// 이미 다른 워커가 비우는 중이면 그 워커가 이어서 처리한다
+		if (mIsExecuting)
+			return;
+
+		mIsExecuting = true;
+	}
+
+	Execute();
+}
+
+void RoomSession::Execute()
+{
+	while (true)
+	{
+		if (mProcessedCount == mProcessingJobs.size())
+		{
+			mProcessingJobs.clear();
+			mProcessedCount = 0;
+
+			SRWLockGuard lock(&mJobLock);
+			if (mPendingJobs.empty())
+			{
+				mIsExecuting = false;
+				return;
+			}
+
+			mProcessingJobs.swap(mPendingJobs);
+		}
+
+		size_t last = min(mProcessedCount + ROOM_JOB_BATCH, mProcessingJobs.size());
+		ProcessJobs(mProcessedCount, last);
+		mProcessedCount = last;
+
+		// 작업이 계속 들어오는 방이 워커 하나를 붙잡지 않도록 한 묶음마다 IOCP로 돌려보낸다
+		if (mOwner->GetCompletionPort() != nullptr)
+		{
+			if (mProcessedCount == mProcessingJobs.size())
+			{
+				SRWLockGuard lock(&mJobLock);
+				if (mPendingJobs.empty())
+				{
+					mProcessingJobs.clear();
+					mProcessedCount = 0;
+					mIsExecuting = false;
+					return;
+				}
+			}
+
+			// 넣지 못하면 이 워커가 마저 처리한다
+			if (ScheduleExecute())
+				return;
+		}
+	}
+}
+
+bool RoomSession::ScheduleExecute()
+{
+	if (!PostQueuedCompletionStatus(mOwner->GetCompletionPort(), 0, (ULONG_PTR)this, &mExecuteOverlappedEx.wsaOverlapped))
+	{
+		cout << "[RoomSession] PostQueuedCompletionStatus Error: " << GetLastError() << endl;
+		return false;
+	}
+
+	return true;
+}
+
+void RoomSession::ProcessJobs(size_t first, size_t last)
+{
+	// 연속된 채팅은 하나의 버퍼로 이어 붙여 멤버당 한 번만 보낸다.
+	// 입장/퇴장 전에는 모아둔 채팅을 먼저 내보내 순서를 지킨다.
+	for (size_t i = first; i < last; ++i)
+	{
+		RoomJob& job = mProcessingJobs[i];
+
+		if (job.type == RoomJobType::CHAT)
+		{
+			if (mRoomState != RoomState::ACTIVE)
+				continue;
+
+			if (mChatBatch.size() + job.payload->size() > MAX_SOCKBUF)
+				FlushChatBatch();
+
+			mChatBatch.insert(mChatBatch.end(), job.payload->begin(), job.payload->end());
+
+			auto* noti = reinterpret_cast<const RoomChatNotiPacket*>(job.payload->data());
+			mHistory.Append(string_view(noti->user, strnlen_s(noti->user, sizeof(noti->user))),
+							string_view(noti->message, strnlen_s(noti->message, sizeof(noti->message))));
+			continue;
+		}
+
+		FlushChatBatch();
+
+		switch (job.type)
+		{
+		case RoomJobType::OPEN:
+			Open(job);
+			break;
+		case RoomJobType::JOIN:
+			Join(job);
+			break;
+		case RoomJobType::QUICK_JOIN:
+			Join(job);
+			// 결과와 관계없이 QuickJoin이 잡아 둔 자리를 푼다. 입장했으면 인원에 이미 반영됐다
+			mOwner->ReleaseSeatHold(this);
+			break;
+		case RoomJobType::LEAVE:
+			Leave(job);
+			break;
+		case RoomJobType::LIST_USER:
+			SendUserList(job);
+			break;
+		default:
+			break;
+		}
+	}
+
+	FlushChatBatch();
 }
 
-ErrorCode RoomSession::JoinUser(ClientSession* session)
+void RoomSession::FlushChatBatch()
 {
+	if (mChatBatch.empty())
+		return;
+
+	BroadCast(make_shared<vector<char>>(mChatBatch));
+	mChatBatch.clear();
+}
+
+void RoomSession::Open(const RoomJob& job)
+{
+	CreateRoomResPacket resPacket;
+
+	if (mRoomState != RoomState::IDLE)
+	{
+		resPacket.result = ErrorCode::ROOM_CREATION_FAIL;
+	}
+	else if (job.session->GetSessionId() != job.sessionId
+		|| !job.session->TrySetUserState(UserState::LOBBY, UserState::IN_ROOM))
+	{
+		// 방장이 그 사이 끊겼거나 다른 방에 들어갔다. 방을 바로 반납한다.
+		resPacket.result = ErrorCode::ALREADY_IN_ROOM;
+		Close();
+	}
+	else if (!ConfirmEnter(job))
+	{
+		// IN_ROOM으로 바꾸는 사이 접속이 끊겼다. 죽은 방장을 넣지 않고 반납한다
+		Close();
+		return;
+	}
+	else
+	{
+		mRoomState = RoomState::ACTIVE;
+		AddMember(job);
+
+		// 방장이 앉은 뒤에야 목록/검색/입장 대상이 된다
+		mOwner->PublishRoom(this);
+
+		resPacket.result = ErrorCode::SUCCESS;
+		resPacket.room = ToRoomInfo();
+	}
+
+	if (job.session->GetSessionId() == job.sessionId)
+		job.session->SendPacket((char*)&resPacket, sizeof(resPacket));
+}
+
+void RoomSession::Join(const RoomJob& job)
+{
+	if (job.session->GetSessionId() != job.sessionId || !job.session->IsValid())
+		return;
+
+	JoinRoomResPacket resPacket;
+
 	if (mRoomState != RoomState::ACTIVE)
-		return ErrorCode::INVALID_ROOM_REQUEST;
+		resPacket.result = ErrorCode::ROOM_NOT_FOUND;
+	else if (IsFull())
+		resPacket.result = ErrorCode::ROOM_FULL;
+	else if (FindSlot(job.session, job.sessionId) != INVALID_ROOM_SLOT)
+		resPacket.result = ErrorCode::ALREADY_IN_ROOM;
+	else if (!job.session->TrySetUserState(UserState::LOBBY, UserState::IN_ROOM))
+		resPacket.result = ErrorCode::ALREADY_IN_ROOM;
+	else if (!ConfirmEnter(job))
+		return;
+	else
+		resPacket.result = ErrorCode::SUCCESS;
+
+	if (job.type == RoomJobType::QUICK_JOIN
+		&& (resPacket.result == ErrorCode::ROOM_NOT_FOUND || resPacket.result == ErrorCode::ROOM_FULL))
+	{
+		// 고른 뒤 처리 전에 방이 찼거나 닫혔다. 이 방을 빼고 다시 고른다.
+		if (mOwner->QuickJoin(job, this) == ErrorCode::SUCCESS)
+			return;
+
+		resPacket.result = ErrorCode::NO_AVAILABLE_ROOM;
+	}
+
+	if (resPacket.result != ErrorCode::SUCCESS)
+	{
+		job.session->SendPacket((char*)&resPacket, sizeof(resPacket));
+		return;
+	}
+
+	AddMember(job);
+	resPacket.room = ToRoomInfo();
+
+	// 첫 묶음은 응답에 싣고 나머지 멤버는 목록 패킷으로 이어 보낸다
+	size_t firstCount = min(mUsers.size(), static_cast<size_t>(MAX_ROOM_USER_CHUNK));
+	resPacket.totalCount = static_cast<uint16_t>(mUsers.size());
+	job.session->SendPacket(BuildUserListPacket(resPacket, 0, firstCount));
+	SendUserListChunks(job.session, firstCount);
+
+	// 그 뒤에 지금까지의 대화를 한 프레임으로 보낸다
+	SendBufferPtr history = mHistory.BuildNotiPacket();
+	if (history != nullptr)
+		job.session->SendPacket(history);
+}
+
+// 접속 종료는 DISCONNECTING으로 바꾼 뒤 IN_ROOM이면 roomId로 LEAVE를 넣는다.
+// 여기서는 roomId를 먼저 쓰고 상태를 보므로, 둘 중 한쪽은 반드시 상대의 변경을 본다.
+// 종료 쪽이 못 봤으면 여기서 되돌리고, 봤으면 뒤따라오는 LEAVE가 멤버를 뺀다.
+bool RoomSession::ConfirmEnter(const RoomJob& job)
+{
+	job.session->SetRoomId(mRoomId);
+
+	if (job.session->IsAuthenticated() && job.session->GetSessionId() == job.sessionId)
+		return true;
+
+	job.session->SetRoomId(INVALID_ROOM_ID);
+	job.session->SetUserState(UserState::LOBBY);
+	return false;
+}
+
+void RoomSession::Leave(const RoomJob& job)
+{
+	uint32_t slot = FindSlot(job.session, job.sessionId);
+	bool sameSession = job.session->GetSessionId() == job.sessionId;
+
+	LeaveRoomResPacket resPacket;
+	resPacket.result = (slot != INVALID_ROOM_SLOT) ? ErrorCode::SUCCESS : ErrorCode::INVALID_STATE;
+
+	if (slot != INVALID_ROOM_SLOT)
+	{
+		RoomMember member = RemoveMemberAt(slot);
+		mOwner->OnRoomUpdated(this);
+
+		job.session->SetRoomSlot(job.sessionId, INVALID_ROOM_SLOT);
+		if (sameSession)
+		{
+			job.session->SetUserState(UserState::LOBBY);
+			job.session->SetRoomId(INVALID_ROOM_ID);
+		}
+
+		LeaveNotify(member);
+	}
+	else if (!sameSession)
+	{
+		// 끊긴 세션의 슬롯이 LEAVE 도착 전에 다른 접속에 재사용된 경우에만 자리를 잃는다. 죽은 멤버를 정리한다.
+		PruneDeadMembers();
+	}
+
+	if (sameSession && job.session->IsValid())
+		job.session->SendPacket((char*)&resPacket, sizeof(resPacket));
+
+	if (mRoomState == RoomState::ACTIVE && mUsers.empty())
+		Close();
+}
+
+void RoomSession::SendUserList(const RoomJob& job)
+{
+	if (job.session->GetSessionId() != job.sessionId || !job.session->IsValid())
+		return;
+
+	if (mRoomState != RoomState::ACTIVE || FindSlot(job.session, job.sessionId) == INVALID_ROOM_SLOT)
+	{
+		RoomUserListResPacket resPacket;
+		resPacket.result = ErrorCode::INVALID_STATE;
+		job.session->SendPacket((char*)&resPacket, sizeof(resPacket));
+		return;
+	}
+
+	SendUserListChunks(job.session, 0);
+}
+
+template <typename T>
+SendBufferPtr RoomSession::BuildUserListPacket(T& header, size_t first, size_t count) const
+{
+	header.userCount = static_cast<uint16_t>(count);
+	header.SetSize(static_cast<uint16_t>(sizeof(T) + count * sizeof(UserInfo)));
+
+	auto buffer = make_shared<vector<char>>(sizeof(T) + count * sizeof(UserInfo));
+	memcpy(buffer->data(), &header, sizeof(T));
+
+	UserInfo* users = reinterpret_cast<UserInfo*>(buffer->data() + sizeof(T));
+	for (size_t i = 0; i < count; ++i)
+	{
+		const RoomMember& member = mUsers[first + i];
+		users[i] = UserInfo(member.sessionId, member.nickname);
+	}
 
-	if (IsFull())
-		return ErrorCode::ROOM_FULL;
+	return buffer;
+}
+
+void RoomSession::SendUserListChunks(ClientSession* session, size_t first) const
+{
+	RoomUserListResPacket resPacket;
+	resPacket.result = ErrorCode::SUCCESS;
+	resPacket.totalCount = static_cast<uint16_t>(mUsers.size());
+
+	// 빈 목록이라도 요청한 쪽에는 응답 한 개는 보낸다
+	if (first == 0 && mUsers.empty())
+	{
+		session->SendPacket(BuildUserListPacket(resPacket, 0, 0));
+		return;
+	}
 
-	if (HasSession(session))
-		return ErrorCode::ALREADY_IN_ROOM;
+	for (size_t offset = first; offset < mUsers.size(); offset += MAX_ROOM_USER_CHUNK)
+	{
+		size_t count = min(mUsers.size() - offset, static_cast<size_t>(MAX_ROOM_USER_CHUNK));
+		resPacket.firstIndex = static_cast<uint16_t>(offset);
+		session->SendPacket(BuildUserListPacket(resPacket, offset, count));
+	}
+}
+
+void RoomSession::AddMember(const RoomJob& job)
+{
+	ClientSession* session = job.session;
+	RoomMember member{ job.session, job.sessionId };
+	memcpy(member.nickname, job.nickname, sizeof(member.nickname));
 
-	mUsers.push_back(session);
+	session->SetRoomSlot(member.sessionId, static_cast<uint32_t>(mUsers.size()));
+	mUsers.push_back(member);
+	mUserCount = (uint16_t)mUsers.size();
+	mFanoutDirty = true;
+	mOwner->OnRoomUpdated(this);
 
-	session->SetUserState(UserState::IN_ROOM);
 	session->SetRoomId(mRoomId);
 
-	JoinNotify(session);
+	JoinNotify(member);
+}
+
+void RoomSession::PruneDeadMembers()
+{
+	// LEAVE 작업이 도착하기 전에 끊긴 세션 (입장과 접속 종료가 엇갈린 경우 포함)
+	vector<RoomMember> dead;
+	for (uint32_t slot = 0; slot < mUsers.size(); )
+	{
+		if (mUsers[slot].IsAlive())
+		{
+			++slot;
+			continue;
+		}
+
+		dead.push_back(RemoveMemberAt(slot));
+	}
+
+	if (dead.empty())
+		return;
+
+	mOwner->OnRoomUpdated(this);
+
+	for (auto& member : dead)
+		LeaveNotify(member);
 
-	return ErrorCode::SUCCESS;
+	if (mRoomState == RoomState::ACTIVE && mUsers.empty())
+		Close();
 }
 
-bool RoomSession::LeaveUser(ClientSession* session)
+void RoomSession::Close()
 {
-	auto it = std::find(mUsers.begin(), mUsers.end(), session);
-	if (it == mUsers.end())
-		return false;
+	vector<RoomMember>().swap(mUsers);
+	vector<char>().swap(mChatBatch);
+	vector<pair<WorkerMailbox*, FanoutListPtr>>().swap(mFanoutShards);
+	mFanoutDirty = true;
+	mHistory.Clear();
+	mUserCount = 0;
+	mRoomState = RoomState::CLOSING;
 
-	std::iter_swap(it, mUsers.end() - 1);
-	mUsers.pop_back();
+	// 디렉터리에서 빠지고 나면 다음 OPEN 작업이 이 방을 다시 쓸 수 있다
+	mOwner->RemoveRoomSession(this);
 
-	session->SetUserState(UserState::LOBBY);
-	session->SetRoomId(INVALID_ROOM_ID);
+	mRoomState = RoomState::IDLE;
+}
 
-	LeaveNotify(session);
+uint32_t RoomSession::FindSlot(ClientSession* session, uint32_t sessionId) const
+{
+	uint32_t slot = session->GetRoomSlot(sessionId);
+	if (slot < mUsers.size() && mUsers[slot].session == session && mUsers[slot].sessionId == sessionId)
+		return slot;
 
-	if (mUsers.empty())
-		mRoomState = RoomState::CLOSING;
-	
-	return mUsers.empty();
-} 
+	return INVALID_ROOM_SLOT;
+}
 
-bool RoomSession::HasSession(ClientSession* session)
+RoomMember RoomSession::RemoveMemberAt(uint32_t slot)
 {
-	for (auto* u : mUsers)
+	RoomMember removed = mUsers[slot];
+
+	// 맨 뒤 멤버를 빈 자리로 옮기고 그 세션의 슬롯을 갱신한다.
+	// 그 사이 세션이 재사용됐으면 sessionId가 달라 SetRoomSlot이 아무것도 쓰지 않는다
+	if (slot != mUsers.size() - 1)
 	{
-		if (u == session)
-			return true;
+		mUsers[slot] = mUsers.back();
+		mUsers[slot].session->SetRoomSlot(mUsers[slot].sessionId, slot);
 	}
-	return false;
+
+	mUsers.pop_back();
+	mUserCount = (uint16_t)mUsers.size();
+	mFanoutDirty = true;
+
+	return removed;
 }
 
-void RoomSession::JoinNotify(ClientSession* joinSession)
+// 입장/퇴장은 전체 목록 대신 바뀐 한 명만 알린다
+void RoomSession::JoinNotify(const RoomMember& member)
 {
-	SystemNotiPacket notiPacket;
-	string joinMsg = joinSession->GetUsername() + " Joined the room.";
-	strncpy_s(notiPacket.message, sizeof(notiPacket.message), joinMsg.c_str(), _TRUNCATE);
-	BroadCast((char*)&notiPacket, sizeof(notiPacket));
+	UserJoinNotifyPacket notiPacket;
+	notiPacket.roomId = mRoomId;
+	notiPacket.SetUser(member.sessionId, member.nickname);
+
+	// 본인은 입장 응답의 목록으로 받는다
+	BroadCast(MakeSendBuffer((char*)&notiPacket, sizeof(notiPacket)), member.session);
 }
 
-void RoomSession::LeaveNotify(ClientSession* leaveSession)
+void RoomSession::LeaveNotify(const RoomMember& member)
 {
-	SystemNotiPacket notiPacket;
-	string leaveMsg = leaveSession->GetUsername() + " left the room.";
-	strncpy_s(notiPacket.message, sizeof(notiPacket.message), leaveMsg.c_str(), _TRUNCATE);
+	UserLeaveNotifyPacket notiPacket;
+	notiPacket.roomId = mRoomId;
+	notiPacket.SetUser(member.sessionId, member.nickname);
 	BroadCast((char*)&notiPacket, sizeof(notiPacket));
 }
 
 void RoomSession::BroadCast(const char* data, int length)
 {
-	for (auto* session : mUsers)
+	BroadCast(MakeSendBuffer(data, length));
+}
+
+void RoomSession::BroadCast(const SendBufferPtr& buffer, const ClientSession* except)
+{
+	if (mUsers.size() >= ROOM_FANOUT_THRESHOLD)
 	{
-		if (session->IsValid())
-		{
-			session->SendPacket(data, length);
-		}
+		BroadCastSharded(buffer, except);
+		return;
+	}
+
+	bool hasDeadMember = false;
+
+	for (auto& member : mUsers)
+	{
+		if (member.session == except)
+			continue;
+
+		if (member.IsAlive())
+			member.session->PostPacket(member.sessionId, buffer);
+		else
+			hasDeadMember = true;
 	}
+
+	if (hasDeadMember)
+		PruneDeadMembers();
 }
 
-RoomInfo RoomSession::ToRoomInfo() const
+// 실행 워커는 우편함 수만큼만 게시하고, 실제 전송은 각 우편함을 비우는 워커가 나눠 맡는다.
+// 세션은 항상 같은 우편함으로 가므로 우편함을 거친 방 알림끼리는 수신자별 게시 순서가 지켜진다.
+// 다만 요청 처리 워커가 SendPacket으로 바로 보내는 응답(입장 응답 등)은 이 순서 밖이다.
+// 끊긴 멤버는 우편함이 건너뛰면서 표시해 두고, 다음 브로드캐스트 전에 여기서 명단을 정리한다.
+void RoomSession::BroadCastSharded(const SendBufferPtr& buffer, const ClientSession* except)
 {
-	return RoomInfo(mRoomId, mName, mMaxUserCount, (uint16_t)mUsers.size());
+	if (mFanoutDeadSeen.exchange(false))
+	{
+		PruneDeadMembers();
+
+		// 정리하다 방이 비었거나 작아졌으면 그에 맞게 보낸다
+		if (mUsers.size() < ROOM_FANOUT_THRESHOLD)
+		{
+			BroadCast(buffer, except);
+			return;
+		}
+	}
+
+	if (mFanoutDirty)
+		RebuildFanoutShards();
+
+	for (auto& [mailbox, targets] : mFanoutShards)
+		mailbox->PostFanout(targets, buffer, except);
 }
 
-int RoomSession::FillUserList(UserInfo* outList, int maxCount) const
+void RoomSession::RebuildFanoutShards()
 {
-	int count = 0;
-	for (auto* session : mUsers)
+	vector<pair<WorkerMailbox*, vector<FanoutTarget>>> buckets;
+
+	for (auto& member : mUsers)
 	{
-		if (count >= maxCount) break;
-		outList[count++] = session->ToUserInfo();
+		WorkerMailbox* mailbox = member.session->GetMailbox();
+
+		// 우편함 수는 워커 수 정도라 선형 탐색으로 충분하다
+		auto it = find_if(buckets.begin(), buckets.end(),
+			[mailbox](const auto& bucket) { return bucket.first == mailbox; });
+		if (it == buckets.end())
+		{
+			buckets.emplace_back(mailbox, vector<FanoutTarget>());
+			buckets.back().second.reserve(mUsers.size() / 4 + 1);
+			it = buckets.end() - 1;
+		}
+
+		it->second.push_back({ member.session, member.sessionId });
 	}
-	return count;
-}
\ No newline at end of file
+
+	// 우편함이 아직 이전 묶음을 읽고 있을 수 있어 고치지 않고 새로 만든다
+	mFanoutShards.clear();
+	for (auto& [mailbox, targets] : buckets)
+		mFanoutShards.emplace_back(mailbox, make_shared<const FanoutList>(FanoutList{ std::move(targets), &mFanoutDeadSeen }));
+
+	mFanoutDirty = false;
+}
+
+RoomInfo RoomSession::ToRoomInfo() const
+{
+	return RoomInfo(mRoomId, mName, mMaxUserCount, mUserCount);
+}
@@ -1,27 +1,95 @@
 #pragma once
 #include <vector>
+#include <algorithm>
 #include "ClientSession.h"
+#include "RoomHistory.h"
+#include "WorkerMailbox.h"
 #include "SRWLockGuard.h"
 #include "../Common/Packet.h"
 
+#define ROOM_FANOUT_THRESHOLD 256	// 이 인원 이상인 방은 우편함별로 나눠 여러 워커가 함께 보낸다
+#define ROOM_JOB_BATCH 256			// 한 번에 처리할 방 작업 수. 남으면 IOCP에 다시 넣는다
+
 using namespace std;
 
+class RoomManager;
+
 enum class RoomState {
 	IDLE,     // 비활성
 	ACTIVE,   // 활성
 	CLOSING,  // 종료 중
 };
 
+enum class RoomJobType
+{
+	OPEN,		// 방 생성 + 방장 입장
+	JOIN,
+	LEAVE,
+	CHAT,
+	LIST_USER,
+	QUICK_JOIN,	// JOIN과 같지만 자리가 없으면 다른 방을 다시 고른다
+};
+
+// 방으로 들어오는 요청. 세션 슬롯이 재사용될 수 있으므로 sessionId를 함께 기록한다.
+struct RoomJob
+{
+	RoomJobType type;
+	SessionRef session;
+	uint32_t sessionId;
+	SendBufferPtr payload;		// CHAT: 미리 만든 RoomChatNotiPacket
+	char nickname[MAX_USER_NAME + 1];	// OPEN/JOIN/QUICK_JOIN: 넣을 때 복사한 이름. 방 워커는 세션의 이름을 읽지 않는다
+};
+
+struct RoomMember
+{
+	SessionRef session;
+	uint32_t sessionId;
+	char nickname[MAX_USER_NAME + 1];	// 퇴장 알림 시점엔 세션 이름이 이미 해제됐을 수 있다
+
+	bool IsAlive() const { return session->GetSessionId() == sessionId && session->IsValid(); }
+};
+
+// 방 로직은 락 없이 작업 큐로 직렬화한다.
+// 큐에 작업을 넣은 워커가 실행 중인 워커가 없으면 직접 ROOM_JOB_BATCH개까지 처리하고,
+// 남은 작업은 ROOM_EXECUTE 완료 통지로 다시 넣어 아무 워커나 이어서 처리한다.
+// 실행 중 표시는 큐가 빌 때까지 유지하므로 한 방의 작업은 한 번에 한 워커에서 순서대로 실행된다.
 class RoomSession
 {
 private:
-	bool HasSession(ClientSession* session);
+	void ProcessJobs(size_t first, size_t last);
+	bool ScheduleExecute();
+
+	void Open(const RoomJob& job);
+	void Join(const RoomJob& job);
+	// IN_ROOM으로 바꾼 세션이 그 사이 끊기지 않았는지 다시 확인한다. 끊겼으면 되돌리고 false
+	bool ConfirmEnter(const RoomJob& job);
+	void Leave(const RoomJob& job);
+	void SendUserList(const RoomJob& job);
+	void FlushChatBatch();
+
+	// 세션이 기억하는 슬롯으로 O(1) 확인. 멤버가 아니면 INVALID_ROOM_SLOT
+	uint32_t FindSlot(ClientSession* session, uint32_t sessionId) const;
+	void AddMember(const RoomJob& job);
+	RoomMember RemoveMemberAt(uint32_t slot);
+	void PruneDeadMembers();
+	void Close();
+
+	// 헤더 뒤에 mUsers[first]부터 count명의 UserInfo를 붙인 가변 길이 패킷
+	template <typename T>
+	SendBufferPtr BuildUserListPacket(T& header, size_t first, size_t count) const;
+	// first번째 멤버부터 끝까지 RoomUserListResPacket 묶음으로 보낸다
+	void SendUserListChunks(ClientSession* session, size_t first) const;
 
-	void JoinNotify(ClientSession* joinSession);
-	void LeaveNotify(ClientSession* leaveSession);
+	void BroadCast(const char* data, int length);
+	void BroadCast(const SendBufferPtr& buffer, const ClientSession* except = nullptr);
+	void BroadCastSharded(const SendBufferPtr& buffer, const ClientSession* except);
+	void RebuildFanoutShards();
+
+	void JoinNotify(const RoomMember& member);
+	void LeaveNotify(const RoomMember& member);
 
 public:
-	explicit RoomSession(uint16_t roomId);
+	RoomSession(uint32_t roomId, RoomManager* owner);
 	~RoomSession() = default;
 
 	RoomSession(const RoomSession&) = delete;
@@ -29,37 +97,60 @@ public:
 	RoomSession(RoomSession&&) = delete;
 	RoomSession& operator=(RoomSession&&) = delete;
 
-	void Init(uint16_t maxUserCount);
+	// RoomManager가 디렉터리 락 안에서 방을 배정할 때 호출
+	void Prepare(const string& name, uint16_t maxUserCount);
 
-	void SetRoomName(const string& name) { mName = name; }
-	void SetMaxUserCount(uint16_t maxUserCount) { mMaxUserCount = maxUserCount; }
+	void PushJob(RoomJob&& job);
+	// PushJob 또는 ROOM_EXECUTE 완료 통지를 받은 워커가 호출
+	void Execute();
 
-	uint16_t GetRoomId() const { return mRoomId; }
+	uint32_t GetRoomId() const { return mRoomId; }
 	const string& GetRoomName() const { return mName; }
 	uint16_t GetMaxUserCount() const { return mMaxUserCount; }
-	uint16_t GetCurrentUserCount() const { return mUsers.size(); }
+	uint16_t GetCurrentUserCount() const { return mUserCount; }
 
-	ErrorCode JoinUser(ClientSession* session);
-	bool LeaveUser(ClientSession* session);
+	// RoomManager 매칭 색인에 올라간 빈자리 수 (매칭 락 안에서만 접근, 0이면 색인에 없음)
+	uint16_t GetMatchFreeSeats() const { return mMatchFreeSeats; }
+	void SetMatchFreeSeats(uint16_t freeSeats) { mMatchFreeSeats = freeSeats; }
+	// 빠른 입장이 골라 두고 아직 방이 처리하지 않은 자리 수 (매칭 락 안에서만 접근)
+	uint16_t GetSeatHolds() const { return mSeatHolds; }
+	void SetSeatHolds(uint16_t seatHolds) { mSeatHolds = seatHolds; }
 
-	bool IsFull() const { return mUsers.size() == mMaxUserCount; }
-	bool IsEmpty() const { return mUsers.size() == 0; }
+	bool IsFull() const { return mUserCount >= mMaxUserCount; }
+	bool IsEmpty() const { return mUserCount == 0; }
 
 	RoomInfo ToRoomInfo() const;
-	int FillUserList(UserInfo* outList, int maxCount) const;
 
-	void BroadCast(const char* data, int length);
-
-	void Clear();
 private:
-	uint16_t mRoomId;
+	uint32_t mRoomId;
+	RoomManager* const mOwner;
 	string mName;
 
 	uint16_t mCurPage;
 	uint16_t mMaxUserCount;
+	uint16_t mMatchFreeSeats;
+	uint16_t mSeatHolds;
+
+	// 실행 중인 워커만 접근. 들어온 만큼만 늘리고 Close에서 반납한다 (최대 인원만큼 미리 잡지 않는다).
+	// 빈틈없이 유지하며 mUsers[session->GetRoomSlot(sessionId)] == 그 세션이다.
+	vector<RoomMember> mUsers;
+	vector<RoomJob> mProcessingJobs;
+	size_t mProcessedCount;			// mProcessingJobs 중 처리를 끝낸 수
+	vector<char> mChatBatch;
+	RoomHistory mHistory;
+
+	// 큰 방 팬아웃용 우편함별 멤버 묶음. 멤버가 바뀌면 다음 브로드캐스트 때 다시 만든다.
+	vector<pair<WorkerMailbox*, FanoutListPtr>> mFanoutShards;
+	bool mFanoutDirty;
+	atomic<bool> mFanoutDeadSeen;	// 우편함이 팬아웃 중 끊긴 멤버를 만나면 세운다
+
+	atomic<uint16_t> mUserCount;			// 목록 조회용
+	atomic<RoomState> mRoomState;
 
-	vector<ClientSession*> mUsers;
+	// 작업 큐만 보호한다 (push/swap)
+	SRWLOCK mJobLock;
+	vector<RoomJob> mPendingJobs;
+	bool mIsExecuting;
 
-	atomic<RoomState> mRoomState;
+	OverlappedEx mExecuteOverlappedEx;
 };
-
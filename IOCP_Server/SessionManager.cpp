@@ -1,92 +1,255 @@
 #include "SessionManager.h"
 #include <iostream>
+#include <algorithm>
 
-SessionManager::SessionManager(UINT32 maxSessionCount) : mActiveSessionCount(0)
+SessionChunk::SessionChunk(UINT32 chunkIndex, const vector<WorkerMailbox*>& mailboxes)
+	: hotStates(std::make_unique<SessionHotState[]>(SESSION_CHUNK_SIZE))
+	, inUseCount(0)
+	, idleSince(GetTickCount64())
+{
+	sessions.reserve(SESSION_CHUNK_SIZE);
+
+	for (UINT32 i = 0; i < SESSION_CHUNK_SIZE; ++i)
+	{
+		UINT32 poolIndex = chunkIndex * SESSION_CHUNK_SIZE + i;
+		WorkerMailbox* mailbox = mailboxes[poolIndex % mailboxes.size()];
+		sessions.emplace_back(std::make_unique<ClientSession>(poolIndex, &hotStates[i], mailbox));
+	}
+
+	// 낮은 슬롯부터 꺼내 쓰도록 역순으로 쌓는다
+	for (UINT32 i = SESSION_CHUNK_SIZE; i > 0; --i)
+	{
+		freeSlots.push(i - 1);
+	}
+}
+
+SessionManager::SessionManager(UINT32 maxSessionCount, const vector<WorkerMailbox*>& mailboxes)
+	: mMailboxes(mailboxes)
+	, mMaxSessionCount(maxSessionCount)
+	, mInUseSessionCount(0)
+	, mMaxChunkCount((maxSessionCount + SESSION_CHUNK_SIZE - 1) / SESSION_CHUNK_SIZE)
+	, mChunkCount(0)
+	, mActiveSessionCount(0)
 {
 	InitializeSRWLock(&mSrwLock);
 
-	mSessionContainer.reserve(maxSessionCount);
+	// 청크 포인터 배열은 재할당되지 않도록 상한만큼 미리 잡고, 청크는 필요할 때 만든다
+	mChunks.resize(mMaxChunkCount);
+
+	AddChunk();
+}
 
-	for (UINT32 i = 0; i < maxSessionCount; ++i)
+SessionChunk* SessionManager::AddChunk()
+{
+	if (mChunkCount >= mMaxChunkCount)
+		return nullptr;
+
+	UINT32 chunkIndex = mChunkCount;
+	mChunks[chunkIndex] = std::make_unique<SessionChunk>(chunkIndex, mMailboxes);
+	mChunkCount++;
+
+	return mChunks[chunkIndex].get();
+}
+
+void SessionManager::ShrinkIdleChunks()
+{
+	ULONGLONG now = GetTickCount64();
+
+	// 뒤쪽 청크부터 비어 있고 충분히 오래 쉬었으면 해제한다 (첫 청크는 유지).
+	// 슬롯은 마지막 I/O 완료 뒤에야 비므로 inUseCount == 0이면 걸린 I/O는 없고,
+	// 우편함/방/실행기 큐나 찾기 결과에 남은 참조는 세션마다 SessionRef 수로 확인한다.
+	// 찾기 함수는 이 락 안에서 고정하므로 여기서 고정이 없으면 더 생기지 않는다.
+	while (mChunkCount > 1)
 	{
-		mSessionContainer.emplace_back(std::make_unique<ClientSession>(i));
-		mSessionIndexes.push(i);
-	}	
+		auto& chunk = mChunks[mChunkCount - 1];
+		if (chunk->inUseCount != 0 || now - chunk->idleSince < SESSION_CHUNK_IDLE_MS)
+			break;
+
+		bool pinned = any_of(chunk->sessions.begin(), chunk->sessions.end(),
+			[](const std::unique_ptr<ClientSession>& session) { return session->IsPinned(); });
+		if (pinned)
+			break;
+
+		chunk.reset();
+		mChunkCount--;
+	}
 }
 
 ClientSession* SessionManager::GetEmptySession()
 {
 	SRWLockGuard lock(&mSrwLock);
 
-	ClientSession* client = nullptr;
+	// 청크 단위로 늘어나더라도 설정한 최대 접속 수는 정확히 지킨다
+	if (mInUseSessionCount >= mMaxSessionCount)
+		return nullptr;
+
+	ShrinkIdleChunks();
 
-	if (!mSessionIndexes.empty())
+	// 앞쪽 청크를 먼저 채워서 뒤쪽 청크가 비어 있게 만든다
+	SessionChunk* chunk = nullptr;
+	for (UINT32 i = 0; i < mChunkCount; ++i)
 	{
-		int idx = mSessionIndexes.top();
-		mSessionIndexes.pop();
+		if (!mChunks[i]->freeSlots.empty())
+		{
+			chunk = mChunks[i].get();
+			break;
+		}
+	}
 
-		client = mSessionContainer[idx].get();	 
+	if (chunk == nullptr)
+	{
+		chunk = AddChunk();
+		if (chunk == nullptr)
+			return nullptr;
 	}
-	
-	return client;
+
+	UINT32 slot = chunk->freeSlots.top();
+	chunk->freeSlots.pop();
+	chunk->inUseCount++;
+	mInUseSessionCount++;
+
+	return chunk->sessions[slot].get();
 }
 
-ClientSession* SessionManager::FindSessionByLoginId(const string& loginId)
+FoundSession SessionManager::FindSessionByLoginId(string_view loginId)
 {
+	// 이름 -> id 변환도 같은 락 안에서 해야 그 사이 해제된 id가 다른 이름에 재사용되지 않는다
 	SRWLockGuard lock(&mSrwLock, false);
 
-	auto nameIt = mSessionIdByLoginId.find(loginId);
+	NameId loginNameId = mNameTable.Find(loginId);
+	if (loginNameId == EMPTY_NAME_ID)
+		return {};
+
+	auto nameIt = mSessionIdByLoginId.find(loginNameId);
 	if (nameIt == mSessionIdByLoginId.end())
 	{
-		return nullptr;
+		return {};
 	}
 
-	UINT32 sessionId = nameIt->second;
-	auto sessionIt = mSessionById.find(sessionId);
-	ClientSession* result = (sessionIt != mSessionById.end()) ? sessionIt->second : nullptr;
+	return FindLocked(nameIt->second);
+}
+
+FoundSession SessionManager::FindSessionById(UINT32 sessionId)
+{
+	SRWLockGuard lock(&mSrwLock, false);
 
-	return result;
+	return FindLocked(sessionId);
 }
 
-ClientSession* SessionManager::FindSessionById(UINT32 sessionId)
+FoundSession SessionManager::FindSessionByUsername(string_view username)
 {
 	SRWLockGuard lock(&mSrwLock, false);
 
-	auto it = mSessionById.find(sessionId);
-	ClientSession* result = (it != mSessionById.end()) ? it->second : nullptr;
+	NameId nameId = mNameTable.Find(username);
+	if (nameId == EMPTY_NAME_ID)
+		return {};
+
+	auto it = mSessionByUsername.find(nameId);
+	if (it == mSessionByUsername.end())
+		return {};
 
-	return result;
+	// 등록된 동안은 세션의 id가 바뀌지 않으므로 여기서 읽은 값이 등록 당시의 id다
+	return { SessionRef(it->second), it->second->GetSessionId() };
 }
 
-ClientSession* SessionManager::FindSessionByUsername(const string& username)
+FoundSession SessionManager::FindLocked(UINT32 sessionId)
 {
-	auto it = mSessionByUsername.find(username);
-	if (it == mSessionByUsername.end())
-		return nullptr;
-	return it->second;
+	auto it = mSessionById.find(sessionId);
+	if (it == mSessionById.end())
+		return {};
+
+	// 락을 놓기 전에 고정해야 ShrinkIdleChunks가 청크를 해제하지 않는다
+	return { SessionRef(it->second), sessionId };
 }
 
-void SessionManager::RegisterSession(ClientSession* session)
+bool SessionManager::TryRegisterSession(ClientSession* session, string_view loginId, string_view nickname)
 {
-	SRWLockGuard lock(&mSrwLock);
+	const NameEntry* loginEntry = mNameTable.Intern(loginId);
+	const NameEntry* nameEntry = mNameTable.Intern(nickname);
+
+	{
+		SRWLockGuard lock(&mSrwLock);
+
+		// 접속 종료가 먼저 DISCONNECTING으로 바꿨으면 등록하지 않는다 (해제할 쪽이 이미 지나갔다)
+		if (mSessionIdByLoginId.find(loginEntry->id) == mSessionIdByLoginId.end()
+			&& session->TrySetState(SessionState::CONNECTED, SessionState::AUTHENTICATED))
+		{
+			session->SetLoginId(loginEntry);
+			session->SetUsername(nameEntry);
+
+			mSessionIdByLoginId[loginEntry->id] = session->GetSessionId();
+			mSessionById[session->GetSessionId()] = session;
+			mSessionByUsername[nameEntry->id] = session;
+			mActiveSessionCount++;
+			return true;
+		}
+	}
 
-	mSessionIdByLoginId[session->GetLoginId()] = session->GetSessionId();
-	mSessionById[session->GetSessionId()] = session;
-	mSessionByUsername[session->GetUsername()] = session;
-	mActiveSessionCount++;
+	mNameTable.Release(loginEntry);
+	mNameTable.Release(nameEntry);
+	return false;
 }
 
 void SessionManager::UnregisterSession(ClientSession* session)
 {
 	SRWLockGuard lock(&mSrwLock);
 
-	mSessionIdByLoginId.erase(session->GetLoginId());
+	const NameEntry* loginEntry = session->GetLoginIdEntry();
+	const NameEntry* nameEntry = session->GetUsernameEntry();
+
+	if (loginEntry->id != EMPTY_NAME_ID)
+		mSessionIdByLoginId.erase(loginEntry->id);
+
+	if (nameEntry->id != EMPTY_NAME_ID)
+	{
+		auto it = mSessionByUsername.find(nameEntry->id);
+		if (it != mSessionByUsername.end() && it->second == session)
+			mSessionByUsername.erase(it);
+	}
+
 	mSessionById.erase(session->GetSessionId());
-	mSessionByUsername.erase(session->GetUsername());
-	mSessionIndexes.push(session->GetPoolIndex());
 	mActiveSessionCount--;
 
-	session->Reset();
+	ReturnToPool(session);
+	ShrinkIdleChunks();
+}
+
+void SessionManager::ReleaseSession(ClientSession* session)
+{
+	SRWLockGuard lock(&mSrwLock);
+
+	ReturnToPool(session);
+}
+
+void SessionManager::FreeSession(ClientSession* session)
+{
+	SRWLockGuard lock(&mSrwLock);
+
+	FreeSlot(session);
+	ShrinkIdleChunks();
+}
+
+void SessionManager::ReturnToPool(ClientSession* session)
+{
+	// 걸려 있는 I/O가 있으면 슬롯은 마지막 완료 통지가 FreeSession으로 돌려준다
+	if (session->Reset())
+		FreeSlot(session);
+}
+
+void SessionManager::FreeSlot(ClientSession* session)
+{
+	// 이름은 I/O 참조가 모두 빠진 뒤에 해제한다. 패킷을 처리하던 워커가 아직 이름을 읽고 있을 수 있고,
+	// 해제된 id는 Intern이 다른 이름으로 다시 쓰기 때문이다
+	mNameTable.Release(session->TakeLoginId());
+	mNameTable.Release(session->TakeUsername());
+
+	UINT32 poolIndex = session->GetPoolIndex();
+	auto& chunk = mChunks[poolIndex / SESSION_CHUNK_SIZE];
+	chunk->freeSlots.push(poolIndex % SESSION_CHUNK_SIZE);
+	mInUseSessionCount--;
+
+	if (--chunk->inUseCount == 0)
+		chunk->idleSince = GetTickCount64();
 }
 
 ErrorCode SessionManager::LobbyChat(ClientSession* session, const char* message)
@@ -95,7 +258,7 @@ ErrorCode SessionManager::LobbyChat(ClientSession* session, const char* message)
 		return ErrorCode::INVALID_STATE;
 
 	LobbyChatNotiPacket notiPacket;
-	strncpy_s(notiPacket.user, sizeof(notiPacket.user), session->GetUsername().c_str(), _TRUNCATE);
+	memcpy(notiPacket.user, session->GetUsernameBlob(), sizeof(notiPacket.user));
 	strncpy_s(notiPacket.message, sizeof(notiPacket.message), message, _TRUNCATE);
 
 	BroadcastToLobby((char*)&notiPacket, sizeof(notiPacket));
@@ -104,48 +267,73 @@ ErrorCode SessionManager::LobbyChat(ClientSession* session, const char* message)
 
 ErrorCode SessionManager::WhisperChat(ClientSession* sender, const char* targetName, const char* message)
 {
-	auto* target = FindSessionByUsername(targetName);
-	if (target == nullptr)
+	FoundSession target = FindSessionByUsername(string_view(targetName, strnlen_s(targetName, MAX_USER_NAME + 1)));
+	if (!target)
 		return ErrorCode::USER_NOT_FOUND;
 
 	WhisperChatNotiPacket notiPacket;
-	strncpy_s(notiPacket.sender, sizeof(notiPacket.sender), sender->GetUsername().c_str(), _TRUNCATE);
+	memcpy(notiPacket.sender, sender->GetUsernameBlob(), sizeof(notiPacket.sender));
 	strncpy_s(notiPacket.message, sizeof(notiPacket.message), message, _TRUNCATE);
 
-	target->SendPacket((char*)&notiPacket, sizeof(notiPacket));
+	// 찾은 뒤 대상이 끊겨 슬롯이 재사용됐으면 새 사용자에게 가지 않도록 찾을 때의 id로 보낸다
+	target.session->PostPacket(target.sessionId, MakeSendBuffer((char*)&notiPacket, sizeof(notiPacket)));
 	return ErrorCode::SUCCESS;
 }
 
 void SessionManager::BroadcastAll(const char* data, int length)
 {
+	SendBufferPtr buffer = MakeSendBuffer(data, length);
+
 	SRWLockGuard lock(&mSrwLock, false);
 
-	for (auto& session : mSessionContainer)
+	for (UINT32 c = 0; c < mChunkCount; ++c)
 	{
-		if (session->IsValid())
+		auto& chunk = mChunks[c];
+		for (UINT32 i = 0; i < SESSION_CHUNK_SIZE; ++i)
 		{
-			session->SendPacket(data, length);
+			if (chunk->hotStates[i].IsValid())
+			{
+				auto& session = chunk->sessions[i];
+				session->PostPacket(session->GetSessionId(), buffer);
+			}
 		}
 	}
 }
 
 void SessionManager::BroadcastToLobby(const char* data, int length)
 {
+	SendBufferPtr buffer = MakeSendBuffer(data, length);
+
 	SRWLockGuard lock(&mSrwLock, false);
-	for (auto& session : mSessionContainer)
+
+	// 콜드 영역을 건드리지 않고 Hot 배열만 훑는다
+	for (UINT32 c = 0; c < mChunkCount; ++c)
 	{
-		if (session->IsValid() && session->GetUserState() == UserState::LOBBY)
-			session->SendPacket(data, length);
+		auto& chunk = mChunks[c];
+		for (UINT32 i = 0; i < SESSION_CHUNK_SIZE; ++i)
+		{
+			if (chunk->hotStates[i].IsInLobby())
+			{
+				auto& session = chunk->sessions[i];
+				session->PostPacket(session->GetSessionId(), buffer);
+			}
+		}
 	}
 }
 
 void SessionManager::CloseAllSessions()
 {
-	for (auto& session : mSessionContainer)
+	SRWLockGuard lock(&mSrwLock, false);
+
+	for (UINT32 c = 0; c < mChunkCount; ++c)
 	{
-		if (session->GetState() != SessionState::IDLE)
+		auto& chunk = mChunks[c];
+		for (UINT32 i = 0; i < SESSION_CHUNK_SIZE; ++i)
 		{
-			closesocket(session->GetSocket());
+			if (chunk->hotStates[i].state != SessionState::IDLE)
+			{
+				closesocket(chunk->hotStates[i].socket);
+			}
 		}
 	}
 }
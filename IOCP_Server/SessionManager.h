@@ -1,5 +1,6 @@
 #pragma once
 #include "ClientSession.h"
+#include "WorkerMailbox.h"
 #include "SRWLockGuard.h"
 #include <vector>
 #include <stack>
@@ -8,19 +9,49 @@
 #include <memory>
 #include "../Common/Packet.h"
 
+#define SESSION_CHUNK_SIZE 256
+#define SESSION_CHUNK_IDLE_MS 30000
+
+// 세션 풀의 확장 단위. 한 번 만든 청크 안의 세션은 주소가 바뀌지 않는다 (OVERLAPPED 보관).
+struct SessionChunk
+{
+	SessionChunk(UINT32 chunkIndex, const vector<WorkerMailbox*>& mailboxes);
+
+	std::unique_ptr<SessionHotState[]> hotStates;
+	vector<std::unique_ptr<ClientSession>> sessions;
+	stack<UINT32> freeSlots;
+	UINT32 inUseCount;
+	ULONGLONG idleSince;
+};
+
+// 찾기 결과. session은 락 안에서 고정해 청크가 해제되지 않게 하고, sessionId도 같은 락 안에서 읽는다.
+// 그 뒤 대상이 끊겨 슬롯이 재사용되면 sessionId가 달라지므로 우편함이 걸러 낸다
+struct FoundSession
+{
+	SessionRef session;
+	uint32_t sessionId = 0;
+
+	explicit operator bool() const { return session.Get() != nullptr; }
+};
+
 class SessionManager
 {
 public:
-	SessionManager(UINT32 maxSessionCount);
+	SessionManager(UINT32 maxSessionCount, const vector<WorkerMailbox*>& mailboxes);
 	~SessionManager() = default;
 
 	ClientSession* GetEmptySession();
-	ClientSession* FindSessionByLoginId(const string& loginId);
-	ClientSession* FindSessionByUsername(const string& username);
-	ClientSession* FindSessionById(UINT32 sessionId);
+	FoundSession FindSessionByLoginId(string_view loginId);
+	FoundSession FindSessionByUsername(string_view username);
+	FoundSession FindSessionById(UINT32 sessionId);
 
-	void RegisterSession(ClientSession* session);
+	// 같은 loginId가 등록돼 있지 않고 세션이 아직 CONNECTED일 때만 AUTHENTICATED로 바꾸고 등록한다.
+	// 확인과 등록이 한 락 안에서 일어나므로 동시에 끝난 두 로그인 중 하나만 성공한다
+	bool TryRegisterSession(ClientSession* session, string_view loginId, string_view nickname);
 	void UnregisterSession(ClientSession* session);
+	void ReleaseSession(ClientSession* session);
+	// Reset 뒤 마지막 I/O 완료 통지를 처리한 워커가 슬롯을 풀에 돌려준다
+	void FreeSession(ClientSession* session);
 
 	ErrorCode LobbyChat(ClientSession* session, const char* message);
 	ErrorCode WhisperChat(ClientSession* sender, const char* targetName, const char* message);
@@ -31,15 +62,29 @@ public:
 	void CloseAllSessions();
 
 	int GetActiveSessionCount() const { return mActiveSessionCount; }
+	UINT32 GetReservedSessionCount() const { return mChunkCount * SESSION_CHUNK_SIZE; }
 
 	void SystemNotify(const char* message);
 
 private:
-	vector<std::unique_ptr<ClientSession>> mSessionContainer;
-	stack<int> mSessionIndexes;
+	// mSrwLock 안에서. 세션을 고정해 돌려준다
+	FoundSession FindLocked(UINT32 sessionId);
+	SessionChunk* AddChunk();
+	void ShrinkIdleChunks();
+	void ReturnToPool(ClientSession* session);
+	void FreeSlot(ClientSession* session);
+
+private:
+	vector<WorkerMailbox*> mMailboxes;
+	UINT32 mMaxSessionCount;
+	UINT32 mInUseSessionCount;		// 접속 중 + Reset 뒤 I/O 완료를 기다리는 슬롯. mSrwLock
+	UINT32 mMaxChunkCount;
+	vector<std::unique_ptr<SessionChunk>> mChunks;	// mMaxChunkCount 크기로 고정, 앞에서부터 mChunkCount개 사용
+	atomic<UINT32> mChunkCount;
 
-	unordered_map<string, UINT32> mSessionIdByLoginId;
-	unordered_map<string, ClientSession*> mSessionByUsername;
+	NameTable mNameTable;
+	unordered_map<NameId, UINT32> mSessionIdByLoginId;
+	unordered_map<NameId, ClientSession*> mSessionByUsername;
 	unordered_map<UINT32, ClientSession*> mSessionById;
 
 	atomic<int> mActiveSessionCount;	
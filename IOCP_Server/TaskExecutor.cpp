@@ -0,0 +1,104 @@
+#include "TaskExecutor.h"
+#include "SRWLockGuard.h"
+#include <iostream>
+
+TaskExecutor::TaskExecutor(const string& name, uint32_t threadCount, size_t queueLimit)
+	: mName(name)
+	, mQueueLimit(queueLimit)
+	, mStopping(false)
+{
+	InitializeSRWLock(&mLock);
+	InitializeConditionVariable(&mCondition);
+
+	threadCount = max(threadCount, 1u);
+	for (uint32_t i = 0; i < threadCount; ++i)
+	{
+		mThreads.emplace_back([this]() { WorkerLoop(); });
+	}
+}
+
+TaskExecutor::~TaskExecutor()
+{
+	Stop();
+}
+
+bool TaskExecutor::Submit(function<void()> task)
+{
+	{
+		SRWLockGuard lock(&mLock);
+
+		if (mStopping || mQueue.size() >= mQueueLimit)
+		{
+			mStats.rejected++;
+			return false;
+		}
+
+		mQueue.push_back({ std::move(task), chrono::steady_clock::now() });
+		mStats.submitted++;
+		mStats.maxQueueDepth = max(mStats.maxQueueDepth, mQueue.size());
+	}
+
+	WakeConditionVariable(&mCondition);
+	return true;
+}
+
+void TaskExecutor::Stop()
+{
+	{
+		SRWLockGuard lock(&mLock);
+		if (mStopping)
+			return;
+
+		mStopping = true;
+	}
+
+	WakeAllConditionVariable(&mCondition);
+
+	for (auto& thread : mThreads)
+	{
+		if (thread.joinable())
+			thread.join();
+	}
+
+	TaskExecutorStats stats = GetStats();
+	cout << "[TaskExecutor:" << mName << "] completed " << stats.completed << "/" << stats.submitted
+		<< ", rejected " << stats.rejected << ", max queue " << stats.maxQueueDepth << endl;
+}
+
+TaskExecutorStats TaskExecutor::GetStats()
+{
+	SRWLockGuard lock(&mLock);
+
+	TaskExecutorStats stats = mStats;
+	stats.queueDepth = mQueue.size();
+	return stats;
+}
+
+void TaskExecutor::WorkerLoop()
+{
+	while (true)
+	{
+		Task task;
+		{
+			SRWLockGuard lock(&mLock);
+
+			while (mQueue.empty() && !mStopping)
+				SleepConditionVariableSRW(&mCondition, &mLock, INFINITE, 0);
+
+			if (mQueue.empty())
+				return;
+
+			task = std::move(mQueue.front());
+			mQueue.pop_front();
+		}
+
+		auto startedAt = chrono::steady_clock::now();
+		task.fn();
+		auto finishedAt = chrono::steady_clock::now();
+
+		SRWLockGuard lock(&mLock);
+		mStats.completed++;
+		mStats.totalWaitUs += chrono::duration_cast<chrono::microseconds>(startedAt - task.enqueuedAt).count();
+		mStats.totalRunUs += chrono::duration_cast<chrono::microseconds>(finishedAt - startedAt).count();
+	}
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <Windows.h>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <string>
+#include <atomic>
+#include <chrono>
+#include <functional>
+
+using namespace std;
+
+struct TaskExecutorStats
+{
+	uint64_t submitted = 0;
+	uint64_t completed = 0;
+	uint64_t rejected = 0;		// 큐가 가득 차서 거절한 수
+	size_t queueDepth = 0;
+	size_t maxQueueDepth = 0;
+	uint64_t totalWaitUs = 0;	// 큐에서 기다린 시간 합
+	uint64_t totalRunUs = 0;	// 실행 시간 합
+};
+
+// I/O 워커를 막는 작업(DB 등)을 전용 스레드에서 돌리는 고정 크기 실행기.
+// 큐 상한을 넘으면 Submit이 false를 돌려주므로 호출한 쪽이 바로 실패 응답을 보낸다.
+// 결과를 세션에 반영할 때는 작업 안에서 세션 우편함으로 되돌려 보낸다 (WorkerMailbox::PostTask).
+class TaskExecutor
+{
+public:
+	TaskExecutor(const string& name, uint32_t threadCount, size_t queueLimit);
+	~TaskExecutor();
+
+	TaskExecutor(const TaskExecutor&) = delete;
+	TaskExecutor& operator=(const TaskExecutor&) = delete;
+
+	bool Submit(function<void()> task);
+
+	// 남은 작업을 모두 실행한 뒤 스레드를 멈춘다
+	void Stop();
+
+	TaskExecutorStats GetStats();
+	const string& GetName() const { return mName; }
+
+private:
+	void WorkerLoop();
+
+private:
+	struct Task
+	{
+		function<void()> fn;
+		chrono::steady_clock::time_point enqueuedAt;
+	};
+
+	const string mName;
+	const size_t mQueueLimit;
+	vector<thread> mThreads;
+
+	SRWLOCK mLock;
+	CONDITION_VARIABLE mCondition;
+	deque<Task> mQueue;					// mLock
+	bool mStopping;						// mLock
+	TaskExecutorStats mStats;			// mLock
+};
@@ -0,0 +1,122 @@
+#include "UserCache.h"
+#include "SRWLockGuard.h"
+#include <functional>
+
+UserCache::UserCache(size_t capacity, uint32_t ttlMs)
+	: mShardCapacity(max<size_t>(1, capacity / USER_CACHE_SHARDS))
+	, mTtl(ttlMs)
+{
+	for (auto& shard : mShards)
+		InitializeSRWLock(&shard.lock);
+}
+
+UserCache::Shard& UserCache::GetShard(const string& loginId)
+{
+	return mShards[hash<string>{}(loginId) % USER_CACHE_SHARDS];
+}
+
+bool UserCache::Get(const string& loginId, UserRow& outUser)
+{
+	Shard& shard = GetShard(loginId);
+	SRWLockGuard lock(&shard.lock);
+
+	auto it = shard.index.find(loginId);
+	if (it == shard.index.end())
+	{
+		shard.misses++;
+		return false;
+	}
+
+	if (it->second->expireAt <= Clock::now())
+	{
+		shard.lru.erase(it->second);
+		shard.index.erase(it);
+		shard.expirations++;
+		shard.misses++;
+		return false;
+	}
+
+	shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+	outUser = it->second->user;
+	shard.hits++;
+	return true;
+}
+
+uint64_t UserCache::GetGeneration(const string& loginId)
+{
+	Shard& shard = GetShard(loginId);
+	SRWLockGuard lock(&shard.lock, false);
+
+	return shard.generation;
+}
+
+bool UserCache::Put(const UserRow& user, uint64_t generation)
+{
+	Shard& shard = GetShard(user.loginId);
+	SRWLockGuard lock(&shard.lock);
+
+	// 조회하는 동안 가입/변경이 무효화했다. 읽은 값이 그 전 것일 수 있다
+	if (shard.generation != generation)
+	{
+		shard.staleFills++;
+		return false;
+	}
+
+	Clock::time_point expireAt = Clock::now() + mTtl;
+
+	auto it = shard.index.find(user.loginId);
+	if (it != shard.index.end())
+	{
+		it->second->user = user;
+		it->second->expireAt = expireAt;
+		shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+		return true;
+	}
+
+	if (shard.index.size() >= mShardCapacity)
+	{
+		shard.index.erase(shard.lru.back().user.loginId);
+		shard.lru.pop_back();
+		shard.evictions++;
+	}
+
+	shard.lru.push_front({ user, expireAt });
+	shard.index.emplace(user.loginId, shard.lru.begin());
+	return true;
+}
+
+void UserCache::Invalidate(const string& loginId)
+{
+	Shard& shard = GetShard(loginId);
+	SRWLockGuard lock(&shard.lock);
+
+	// 항목이 없어도 세대는 올린다. 지금 DB를 읽고 있는 조회가 옛 값을 넣지 못하게 한다
+	shard.generation++;
+
+	auto it = shard.index.find(loginId);
+	if (it == shard.index.end())
+		return;
+
+	shard.lru.erase(it->second);
+	shard.index.erase(it);
+	shard.invalidations++;
+}
+
+UserCacheStats UserCache::GetStats()
+{
+	UserCacheStats stats;
+
+	for (auto& shard : mShards)
+	{
+		SRWLockGuard lock(&shard.lock, false);
+		stats.hits += shard.hits;
+		stats.misses += shard.misses;
+		stats.evictions += shard.evictions;
+		stats.expirations += shard.expirations;
+		stats.invalidations += shard.invalidations;
+		stats.staleFills += shard.staleFills;
+		stats.size += shard.index.size();
+	}
+
+	return stats;
+}
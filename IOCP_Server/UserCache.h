@@ -0,0 +1,82 @@
+#pragma once
+#include <Windows.h>
+#include <list>
+#include <string>
+#include <chrono>
+#include <unordered_map>
+#include "UserStore.h"
+
+#define USER_CACHE_SHARDS 16
+#define USER_CACHE_CAPACITY 65536		// 전체 항목 수 상한 (샤드마다 나눠 가진다)
+#define USER_CACHE_TTL_MS 600000		// 넣은 뒤 이 시간이 지나면 DB에서 다시 읽는다
+
+using namespace std;
+
+struct UserCacheStats
+{
+	uint64_t hits = 0;
+	uint64_t misses = 0;
+	uint64_t evictions = 0;		// 용량이 차서 밀려난 수
+	uint64_t expirations = 0;	// TTL이 지나 버린 수
+	uint64_t invalidations = 0;
+	uint64_t staleFills = 0;	// 조회 중 무효화가 끼어들어 버린 Put
+	size_t size = 0;
+
+	double GetHitRate() const { return (hits + misses) > 0 ? (double)hits / (hits + misses) : 0.0; }
+};
+
+// loginId로 찾는 UserRow 캐시. 샤드마다 락과 LRU 목록, 통계를 따로 두어 로그인 스레드끼리 덜 부딪친다.
+// 가입이나 프로필 변경 뒤에는 Invalidate로 지워 다음 조회가 DB를 다시 읽게 한다.
+// DB를 읽기 전에 GetGeneration으로 받은 세대를 Put에 넘기면, 그 사이 같은 샤드에 무효화가 있었던 경우
+// 읽은 값이 옛 값일 수 있으므로 넣지 않는다.
+class UserCache
+{
+public:
+	UserCache(size_t capacity = USER_CACHE_CAPACITY, uint32_t ttlMs = USER_CACHE_TTL_MS);
+	~UserCache() = default;
+
+	UserCache(const UserCache&) = delete;
+	UserCache& operator=(const UserCache&) = delete;
+
+	// 있으면 복사해 주고 가장 최근으로 올린다. 만료된 항목은 지우고 false
+	bool Get(const string& loginId, UserRow& outUser);
+	// DB 조회를 시작하기 전에 받아 둔다
+	uint64_t GetGeneration(const string& loginId);
+	// generation 이후 같은 샤드에 무효화가 있었으면 넣지 않고 false
+	bool Put(const UserRow& user, uint64_t generation);
+	void Invalidate(const string& loginId);
+
+	UserCacheStats GetStats();
+
+private:
+	using Clock = chrono::steady_clock;
+
+	struct Entry
+	{
+		UserRow user;
+		Clock::time_point expireAt;
+	};
+
+	// 통계도 샤드 락 안에서 센다. 샤드끼리 캐시 라인을 나눠 쓰지 않도록 정렬한다
+	struct alignas(64) Shard
+	{
+		SRWLOCK lock;
+		list<Entry> lru;	// 앞쪽이 최근
+		unordered_map<string, list<Entry>::iterator> index;
+		uint64_t generation = 0;	// Invalidate마다 1씩 늘어난다
+
+		uint64_t hits = 0;
+		uint64_t misses = 0;
+		uint64_t evictions = 0;
+		uint64_t expirations = 0;
+		uint64_t invalidations = 0;
+		uint64_t staleFills = 0;
+	};
+
+	Shard& GetShard(const string& loginId);
+
+private:
+	Shard mShards[USER_CACHE_SHARDS];
+	const size_t mShardCapacity;
+	const chrono::milliseconds mTtl;
+};
@@ -0,0 +1,79 @@
+#pragma once
+#include <string>
+#include <functional>
+
+using namespace std;
+
+enum class DbResult
+{
+	OK,
+
+	DUPLICATE_ID,
+	USER_NOT_FOUND,
+	WRONG_PASSWORD,
+
+	CONNECTION_ERROR,
+	QUERY_ERROR,
+
+	BUSY		// 실행기 큐가 가득 차 받지 못했다
+};
+
+struct UserRow
+{
+	long long id = 0;
+	string loginId;
+	string passwordHash;	// PasswordHasher 저장 문자열
+	string nickname;
+};
+
+enum class UserStoreType
+{
+	MYSQL,		// DbManager
+	MEMORY,		// MemoryUserStore. 프로세스 안에만 두므로 재시작하면 비워진다
+};
+
+#define DB_USER_ENV "CHAT_DB_USER"
+#define DB_PASSWORD_ENV "CHAT_DB_PASSWORD"
+
+// 저장소를 고르고 여는 데 필요한 값. 주소/스키마는 서버 인자로 바꾸고,
+// 계정과 비밀번호는 명령줄(프로세스 목록)에 남지 않도록 자격 증명 파일이나 환경 변수로만 받는다. 기본값은 없다
+struct UserStoreConfig
+{
+	UserStoreType type = UserStoreType::MYSQL;
+	string host = "localhost";
+	int port = 33060;
+	string user;
+	string password;
+	string schema = "chat";
+};
+
+// 가입 결과 통지. 저장소마다 부르는 스레드가 다르다
+using RegisterCallback = function<void(DbResult)>;
+
+// 계정 저장소. PacketHandler는 이 인터페이스로만 가입/로그인을 처리한다.
+// 모든 함수는 여러 스레드에서 동시에 불릴 수 있다.
+class UserStore
+{
+public:
+	virtual ~UserStore() = default;
+
+	virtual DbResult RegisterUser(const string& loginId,
+								  const string& passwordHash,
+								  const string& nickname) = 0;
+
+	// 가입을 저장소에 맞는 방식으로 처리하고 done으로 결과를 준다. 받지 못하면 false (done은 불리지 않는다)
+	virtual bool EnqueueRegister(string loginId, string passwordHash, string nickname, RegisterCallback done) = 0;
+
+	// loginId의 계정과 저장된 비밀번호 검증값. 비밀번호 확인은 부른 쪽이 PasswordHasher로 한다
+	virtual DbResult FindUser(const string& loginId, UserRow& outUser) = 0;
+
+	// 프로필(닉네임 등)을 바꾼 뒤 호출해 다음 로그인이 바뀐 값을 읽게 한다
+	virtual void InvalidateUser(const string& loginId) = 0;
+
+	virtual bool IsConnected() const = 0;
+
+	// 남은 쓰기를 마치고 백그라운드 스레드를 멈춘다
+	virtual void Stop() = 0;
+
+	virtual void PrintStats() = 0;
+};
@@ -0,0 +1,140 @@
+#include "WorkerMailbox.h"
+#include "SRWLockGuard.h"
+#include <iostream>
+
+WorkerMailbox::WorkerMailbox(HANDLE iocpHandle)
+	: mIOCPHandle(iocpHandle)
+	, mScheduled(false)
+{
+	InitializeSRWLock(&mSrwLock);
+
+	ZeroMemory(&mFlushOverlappedEx, sizeof(OverlappedEx));
+	mFlushOverlappedEx.operation = IOOperation::FLUSH_MAILBOX;
+}
+
+void WorkerMailbox::Post(ClientSession* session, uint32_t sessionId, const SendBufferPtr& buffer)
+{
+	Push({ session, sessionId, buffer, nullptr });
+}
+
+void WorkerMailbox::PostFanout(const FanoutListPtr& targets, const SendBufferPtr& buffer, const ClientSession* except)
+{
+	Push({ const_cast<ClientSession*>(except), 0, buffer, targets });
+}
+
+void WorkerMailbox::PostTask(ClientSession* session, uint32_t sessionId, MailTask task)
+{
+	bool schedule = false;
+	{
+		SRWLockGuard lock(&mSrwLock);
+
+		mPendingTasks.push_back({ session, sessionId, std::move(task) });
+		schedule = MarkScheduled();
+	}
+
+	if (schedule)
+		Schedule();
+}
+
+void WorkerMailbox::Push(MailItem&& item)
+{
+	bool schedule = false;
+	{
+		SRWLockGuard lock(&mSrwLock);
+
+		mPending.push_back(std::move(item));
+		schedule = MarkScheduled();
+	}
+
+	if (schedule)
+		Schedule();
+}
+
+// mSrwLock 안에서 호출. 이번에 예약해야 하면 true
+bool WorkerMailbox::MarkScheduled()
+{
+	if (mScheduled)
+		return false;
+
+	mScheduled = true;
+	return true;
+}
+
+void WorkerMailbox::Schedule()
+{
+	if (!PostQueuedCompletionStatus(mIOCPHandle, 0, (ULONG_PTR)this, &mFlushOverlappedEx.wsaOverlapped))
+	{
+		cout << "[WorkerMailbox] PostQueuedCompletionStatus Error: " << GetLastError() << endl;
+	}
+}
+
+void WorkerMailbox::Flush()
+{
+	{
+		SRWLockGuard lock(&mSrwLock);
+		mProcessing.swap(mPending);
+		mProcessingTasks.swap(mPendingTasks);
+	}
+
+	// 작업 결과 반영이 먼저다 (로그인 응답 등은 작업 안에서 바로 보낸다)
+	for (auto& item : mProcessingTasks)
+	{
+		if (item.session->GetSessionId() == item.sessionId && item.session->IsValid())
+			item.task(item.session);
+	}
+	mProcessingTasks.clear();
+
+	// 같은 세션으로 가는 패킷은 큐에 모두 쌓은 뒤 세션당 한 번만 전송을 시작한다.
+	// 팬아웃도 같은 순서로 꺼내므로 수신자별 도착 순서는 게시 순서와 같다.
+	for (auto& item : mProcessing)
+	{
+		if (item.targets == nullptr)
+		{
+			Deliver(item.session, item.sessionId, item.buffer);
+			continue;
+		}
+
+		bool hasDead = false;
+		for (auto& target : item.targets->targets)
+		{
+			if (target.session != item.session && !Deliver(target.session, target.sessionId, item.buffer))
+				hasDead = true;
+		}
+
+		if (hasDead)
+			*item.targets->deadSeen = true;
+	}
+
+	for (auto* session : mTouched)
+	{
+		session->FlushSend();
+	}
+
+	mProcessing.clear();
+	mTouched.clear();
+
+	bool reschedule = false;
+	{
+		SRWLockGuard lock(&mSrwLock);
+
+		if (mPending.empty() && mPendingTasks.empty())
+			mScheduled = false;
+		else
+			reschedule = true;
+	}
+
+	// 그 사이 쌓인 건 다시 큐에 넣어 다른 완료 통지와 번갈아 처리되게 한다
+	if (reschedule)
+		Schedule();
+}
+
+bool WorkerMailbox::Deliver(ClientSession* session, uint32_t sessionId, const SendBufferPtr& buffer)
+{
+	if (session->GetSessionId() != sessionId || !session->IsValid())
+		return false;
+
+	if (session->EnqueueSend(buffer))
+		mTouched.push_back(session);
+
+	return true;
+}
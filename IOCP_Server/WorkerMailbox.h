@@ -0,0 +1,87 @@
+#pragma once
+#include <WinSock2.h>
+#include <vector>
+#include <atomic>
+#include <functional>
+#include "ClientSession.h"
+
+using namespace std;
+
+// 큰 방 브로드캐스트 수신자. 같은 우편함에 고정된 세션끼리 묶어 한 번에 넘긴다.
+struct FanoutTarget
+{
+	SessionRef session;
+	uint32_t sessionId;
+};
+
+// 방이 멤버 변경 시에만 새로 만들고 우편함은 읽기만 하므로 공유해도 안전하다.
+// 우편함이 끊긴 대상을 만나면 deadSeen을 세워 방이 다음 브로드캐스트 전에 명단을 정리하게 한다.
+struct FanoutList
+{
+	vector<FanoutTarget> targets;
+	atomic<bool>* deadSeen;		// 방 풀의 RoomSession 소유라 목록보다 오래 산다
+};
+
+using FanoutListPtr = shared_ptr<const FanoutList>;
+
+// 다른 스레드(DB 실행기 등)가 끝낸 작업의 결과를 세션의 워커에서 반영할 때 쓴다
+using MailTask = function<void(ClientSession*)>;
+
+// 다른 워커가 보낸 패킷을 받아두는 단일 소비자 우편함.
+// 세션은 풀 인덱스로 우편함 하나에 고정되고, 우편함은 한 번에 한 워커만 비운다.
+// 우편함을 거친 패킷끼리만 게시 순서가 지켜진다. 요청을 처리한 워커가 SendPacket으로
+// 바로 보내는 응답은 우편함을 거치지 않으므로 먼저 게시된 알림보다 앞설 수 있고,
+// 그래서 SendLock은 여전히 여러 워커가 잡는다.
+class WorkerMailbox
+{
+public:
+	explicit WorkerMailbox(HANDLE iocpHandle);
+	~WorkerMailbox() = default;
+
+	WorkerMailbox(const WorkerMailbox&) = delete;
+	WorkerMailbox& operator=(const WorkerMailbox&) = delete;
+
+	// 비울 때 세션이 sessionId가 아니면(끊겼거나 재사용) 버린다
+	void Post(ClientSession* session, uint32_t sessionId, const SendBufferPtr& buffer);
+	// targets 전원에게 buffer를 보낸다. except는 건너뛴다 (없으면 nullptr)
+	void PostFanout(const FanoutListPtr& targets, const SendBufferPtr& buffer, const ClientSession* except);
+	// 세션이 sessionId 그대로 살아 있을 때만 이 우편함을 비우는 워커에서 task를 실행한다
+	void PostTask(ClientSession* session, uint32_t sessionId, MailTask task);
+	void Flush();
+
+private:
+	// targets가 있으면 팬아웃 항목이고 session은 제외할 세션이다
+	struct MailItem
+	{
+		SessionRef session;
+		uint32_t sessionId;
+		SendBufferPtr buffer;
+		FanoutListPtr targets;
+	};
+
+	struct TaskItem
+	{
+		SessionRef session;
+		uint32_t sessionId;
+		MailTask task;
+	};
+
+	void Push(MailItem&& item);
+	bool MarkScheduled();
+	void Schedule();
+	// 끊겼거나 재사용된 세션이면 false
+	bool Deliver(ClientSession* session, uint32_t sessionId, const SendBufferPtr& buffer);
+
+private:
+	HANDLE mIOCPHandle;
+	OverlappedEx mFlushOverlappedEx;
+
+	vector<MailItem> mPending;			// 생산자 -> mSrwLock
+	vector<MailItem> mProcessing;		// 소비자 전용
+	vector<TaskItem> mPendingTasks;		// 생산자 -> mSrwLock
+	vector<TaskItem> mProcessingTasks;	// 소비자 전용
+	vector<ClientSession*> mTouched;	// 소비자 전용
+	bool mScheduled;
+
+	SRWLOCK mSrwLock;
+};